@@ -0,0 +1,196 @@
+#pragma once
+
+#include "error.hpp"
+#include "token.hpp"
+#include "tokenType.hpp"
+#include "util.hpp"
+#include "warning.hpp"
+#include <array>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <utility>
+
+// Binary operators in dispatch-table order.
+enum class BinaryOp : uint8_t {
+    GREATER,
+    GREATER_EQUAL,
+    LESS,
+    LESS_EQUAL,
+    BANG_EQUAL,
+    EQUAL_EQUAL,
+    PLUS,
+    MINUS,
+    STAR,
+    SLASH,
+    PERCENT,
+    COUNT
+};
+
+// Tags a runtime Value can actually carry (the table's lhs/rhs axes).
+constexpr size_t VALUE_TAG_COUNT = static_cast<size_t>(TypeTag::INSTANCE) + 1;
+constexpr size_t BINARY_OP_COUNT = static_cast<size_t>(BinaryOp::COUNT);
+
+using BinaryKernel = RuntimeValue (*)(const Token&,const RuntimeValue&,const RuntimeValue&);
+
+BinaryOp binaryOpOf(TokenType type) {
+    switch(type) {
+        case TokenType::GREATER:       return BinaryOp::GREATER;
+        case TokenType::GREATER_EQUAL: return BinaryOp::GREATER_EQUAL;
+        case TokenType::LESS:          return BinaryOp::LESS;
+        case TokenType::LESS_EQUAL:    return BinaryOp::LESS_EQUAL;
+        case TokenType::BANG_EQUAL:    return BinaryOp::BANG_EQUAL;
+        case TokenType::EQUAL_EQUAL:   return BinaryOp::EQUAL_EQUAL;
+        case TokenType::PLUS:          return BinaryOp::PLUS;
+        case TokenType::MINUS:         return BinaryOp::MINUS;
+        case TokenType::STAR:          return BinaryOp::STAR;
+        case TokenType::SLASH:         return BinaryOp::SLASH;
+        case TokenType::PERCENT:       return BinaryOp::PERCENT;
+        default:                       return BinaryOp::COUNT;
+    }
+}
+
+namespace binary {
+
+template <TypeTag Tag> struct Native;
+template <> struct Native<TypeTag::BOOLEAN>     { using type = bool; };
+template <> struct Native<TypeTag::INTEGER>     { using type = Integer; };
+template <> struct Native<TypeTag::DECIMAL>     { using type = double; };
+template <> struct Native<TypeTag::BIG_DECIMAL> { using type = BigDecimal; };
+template <> struct Native<TypeTag::STRING>      { using type = std::string; };
+
+template <BinaryOp Op> struct Operation;
+template <> struct Operation<BinaryOp::GREATER>       { using type = std::greater<>; };
+template <> struct Operation<BinaryOp::GREATER_EQUAL> { using type = std::greater_equal<>; };
+template <> struct Operation<BinaryOp::LESS>          { using type = std::less<>; };
+template <> struct Operation<BinaryOp::LESS_EQUAL>    { using type = std::less_equal<>; };
+template <> struct Operation<BinaryOp::BANG_EQUAL>    { using type = std::not_equal_to<>; };
+template <> struct Operation<BinaryOp::EQUAL_EQUAL>   { using type = std::equal_to<>; };
+template <> struct Operation<BinaryOp::PLUS>          { using type = std::plus<>; };
+template <> struct Operation<BinaryOp::MINUS>         { using type = std::minus<>; };
+template <> struct Operation<BinaryOp::STAR>          { using type = std::multiplies<>; };
+template <> struct Operation<BinaryOp::SLASH>         { using type = std::divides<>; };
+template <> struct Operation<BinaryOp::PERCENT>       { using type = std::modulus<>; };
+
+constexpr bool isComparison(BinaryOp op) {
+    return op <= BinaryOp::EQUAL_EQUAL;
+}
+
+constexpr bool isNumeric(TypeTag tag) {
+    return tag == TypeTag::INTEGER || tag == TypeTag::DECIMAL || tag == TypeTag::BIG_DECIMAL;
+}
+
+inline const std::string INCOMPATIBLE = "Operands are of incompatible types!";
+inline const std::string UNSUPPORTED_STRING = "Unsupported operand type for 'string' and 'string'.";
+
+template <TypeTag Tag>
+decltype(auto) get(const RuntimeValue& value) {
+    return value.as<typename Native<Tag>::type>();
+}
+
+// Converts an operand of tag From to tag To, warning like promoteType does.
+template <TypeTag To,TypeTag From>
+RuntimeValue promote(const RuntimeValue& operand,const Token& token) {
+    if constexpr (From == To) {
+        return operand;
+    } else if constexpr (!canPromote(From,To)) {
+        throw RuntimeError(token,INCOMPATIBLE);
+    } else {
+        RuntimeValue result;
+        if constexpr (From == TypeTag::NIL) {
+            if constexpr (To == TypeTag::BOOLEAN) result = false;
+            else if constexpr (To == TypeTag::INTEGER) result = Integer(0);
+            else if constexpr (To == TypeTag::DECIMAL) result = static_cast<double>(0);
+            else result = BigDecimal(0);
+        } else if constexpr (From == TypeTag::BOOLEAN) {
+            bool val = operand.asBool();
+            if constexpr (To == TypeTag::INTEGER) result = Integer(val);
+            else if constexpr (To == TypeTag::DECIMAL) result = static_cast<double>(val);
+            else result = BigDecimal(val);
+        } else if constexpr (From == TypeTag::INTEGER) {
+            if constexpr (To == TypeTag::DECIMAL) result = operand.asInteger().toDecimal();
+            else result = operand.asInteger().toBigDecimal();
+        } else {
+            result = BigDecimal(operand.asDecimal());
+        }
+        std::cout<<ImplicitConversionWarning(token,typeName(To),typeName(From)).message();
+        return result;
+    }
+}
+
+// The operation itself, once both operands have type Tag.
+template <BinaryOp Op,TypeTag Tag>
+RuntimeValue apply(const Token& Operator,const RuntimeValue& left,const RuntimeValue& right) {
+    using Fn = typename Operation<Op>::type;
+
+    if constexpr (Tag == TypeTag::STRING) {
+        if constexpr (isComparison(Op) || Op == BinaryOp::PLUS) return Fn{}(get<Tag>(left),get<Tag>(right));
+        else throw RuntimeError(Operator,UNSUPPORTED_STRING);
+    } else if constexpr (Tag == TypeTag::BOOLEAN) {
+        if constexpr (isComparison(Op)) {
+            return Fn{}(left.asBool(),right.asBool());
+        } else if constexpr (Op == BinaryOp::SLASH || Op == BinaryOp::PERCENT) {
+            if(right.asBool() != false) return Integer(Fn{}(left.asBool(),right.asBool()));
+            if constexpr (Op == BinaryOp::SLASH) {
+                std::cout<<ImplicitConversionWarning(Operator,"boolean","integer").message();
+                throw RuntimeError(Operator,"Divide by zero error ('false' evaluates to '0')");
+            } else {
+                std::cout<<ImplicitConversionWarning(Operator,"integer","boolean").message();
+                throw RuntimeError(Operator,"Modulo by zero error ('false' evaluates to '0')");
+            }
+        } else {
+            std::cout<<ImplicitConversionWarning(Operator,"integer","boolean").message();
+            return Integer(Fn{}(left.asBool(),right.asBool()));
+        }
+    } else if constexpr (isNumeric(Tag)) {
+        if constexpr (Op == BinaryOp::SLASH || Op == BinaryOp::PERCENT) {
+            bool zero;
+            if constexpr (Tag == TypeTag::DECIMAL) zero = right.asDecimal() == 0.0;
+            else zero = get<Tag>(right) == 0;
+            if(zero) throw RuntimeError(Operator,Op == BinaryOp::SLASH ? "Divide by zero error" : "Modulo by zero error");
+        }
+
+        if constexpr (Tag == TypeTag::DECIMAL && Op == BinaryOp::PERCENT) {
+            return fmod(left.asDecimal(),right.asDecimal());
+        } else {
+            return Fn{}(get<Tag>(left),get<Tag>(right));
+        }
+    } else {
+        return _NIL;
+    }
+}
+
+template <BinaryOp Op,TypeTag Left,TypeTag Right>
+RuntimeValue kernel(const Token& Operator,const RuntimeValue& left,const RuntimeValue& right) {
+    constexpr TypeTag target = promotedType(Left,Right);
+    if constexpr (Left == target && Right == target) {
+        return apply<Op,target>(Operator,left,right);
+    } else {
+        RuntimeValue leftval = promote<target,Left>(left,Operator);
+        RuntimeValue rightval = promote<target,Right>(right,Operator);
+        return apply<Op,target>(Operator,leftval,rightval);
+    }
+}
+
+template <BinaryOp Op,size_t... Index>
+constexpr std::array<BinaryKernel,sizeof...(Index)> makeKernels(std::index_sequence<Index...>) {
+    return {&kernel<Op,static_cast<TypeTag>(Index / VALUE_TAG_COUNT),static_cast<TypeTag>(Index % VALUE_TAG_COUNT)>...};
+}
+
+template <size_t... Op>
+constexpr auto makeTable(std::index_sequence<Op...>) {
+    return std::array{makeKernels<static_cast<BinaryOp>(Op)>(std::make_index_sequence<VALUE_TAG_COUNT * VALUE_TAG_COUNT>())...};
+}
+
+} // namespace binary
+
+// One kernel per (operator, lhs tag, rhs tag), built at compile time.
+constexpr auto binaryKernels = binary::makeTable(std::make_index_sequence<BINARY_OP_COUNT>());
+
+RuntimeValue binaryOperation(const Token& Operator,const RuntimeValue& left,const RuntimeValue& right) {
+    BinaryOp op = binaryOpOf(Operator.type);
+    if(op == BinaryOp::COUNT) return _NIL;
+
+    size_t index = static_cast<size_t>(left.typeTag()) * VALUE_TAG_COUNT + static_cast<size_t>(right.typeTag());
+    return binaryKernels[static_cast<size_t>(op)][index](Operator,left,right);
+}
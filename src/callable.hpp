@@ -1,6 +1,7 @@
 #pragma once
 
 #include "expr.hpp"
+#include "heap.hpp"
 #include "token.hpp"
 #include "util.hpp"
 #include <chrono>
@@ -8,21 +9,24 @@
 
 class Interpreter;
 
-class Callable {
+class Callable : public GcObj {
     public:
+        Callable(TypeTag type = TypeTag::FUNCTION) : GcObj(type) {}
         virtual ~Callable() = default;
         virtual int arity() = 0;
         virtual std::string toString() const = 0;
-        virtual RuntimeValue call(Interpreter& interpreter, const Token& name,const std::vector<Expression>& exprs) = 0;
+        // Evaluates the argument expressions and calls with their values.
+        virtual RuntimeValue call(Interpreter& interpreter, const Token& name,const std::vector<Expression>& exprs);
+        virtual RuntimeValue callValues(Interpreter& interpreter, const Token& name,std::vector<RuntimeValue> args) = 0;
 };
 
 class ClockFunction : public Callable {
 public:
-    RuntimeValue call(Interpreter& interpreter, const Token& name,const std::vector<Expression>& exprs) override {
+    RuntimeValue callValues(Interpreter&, const Token&,std::vector<RuntimeValue>) override {
         using namespace std::chrono;
         auto now = duration_cast<std::chrono::milliseconds>(system_clock::now().time_since_epoch()).count();
         double seconds = static_cast<double>(now) / 1000.0;
-        return LiteralValue{seconds, "decimal"};
+        return seconds;
     }
 
     int arity() override { return 0; }
@@ -32,9 +36,18 @@ public:
 
 class TypeOfFunction : public Callable {
     public:
+        // Reports a variable argument's declared type, so it needs the
+        // expression rather than its value.
         RuntimeValue call(Interpreter& interpreter, const Token& name,const std::vector<Expression>& exprs) override;
+        RuntimeValue callValues(Interpreter& interpreter, const Token& name,std::vector<RuntimeValue> args) override;
+
+        static RuntimeValue describe(const RuntimeValue& arg,std::optional<TypeTag> declaredType);
 
         int arity() override { return 1; }
 
         std::string toString() const override { return "<native fn>"; }
 };
+
+CallAble Value::asCallable() const {
+    return CallAble(static_cast<Callable*>(obj()));
+}
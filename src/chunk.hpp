@@ -0,0 +1,125 @@
+#pragma once
+
+#include "inlineCache.hpp"
+#include "token.hpp"
+#include "stmt.hpp"
+#include "util.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+enum class OpCode : uint8_t {
+    CONSTANT,           // u16 constant                     -> value
+    NIL,                //                                  -> nil
+    POP,                // value                            ->
+    GET_LOCAL,          // u16 depth, u16 slot              -> value
+    SET_LOCAL,          // u16 depth, u16 slot   value      -> value
+    GET_GLOBAL,         // u16 name                         -> value
+    SET_GLOBAL,         // u16 name              value      -> value
+    DEFINE,             // u16 slot, u16 name, u16 type  value ->
+    GET_PROPERTY,       // u16 name, u16 cache   object     -> value
+    SET_PROPERTY,       // u16 name, u16 cache   object val -> value
+    GET_SUPER,          // u16 depth, u16 method, u16 cache -> bound method
+    BINARY,             // u16 operator          lhs rhs    -> value
+    UNARY,              // u16 operator          value      -> value
+    STEP,               // u16 operator, u8 kind value      -> result, stepped
+    TRUTHY,             // value                            -> boolean
+    JUMP,               // u16 offset
+    JUMP_IF_FALSE,      // u16 offset            cond       ->
+    JUMP_IF_TRUE_KEEP,  // u16 offset            cond       -> cond
+    JUMP_IF_FALSE_KEEP, // u16 offset            cond       -> cond
+    LOOP,               // u16 offset
+    PRINT,              // value                            ->
+    CALL,               // u8 argc, u16 name, u16 paren, u16 argVariable, u16 argDepth, u16 argSlot
+    INVOKE,             // u16 method, u16 cache, then CALL's operands (obj.method(...))
+    INLINE_ARGS,        // u16 inline            args...    -> (stored in the frame)
+    INLINE_RETURN,      // u16 inline            value      -> converted value
+    GET_INVARIANT,      // u16 depth, u16 slot, u16 offset  -> [cached value, jumped over]
+    SET_INVARIANT,      // u16 depth, u16 slot   value      -> value
+    CLEAR_INVARIANTS,   // u16 slot, u16 count
+    COUNTED_TEST,       // u16 slot, u16 operator, u16 offset  limit ->
+    COUNTED_STEP,       // u16 slot, u16 step, u16 offset
+    FUNCTION,           // u16 function
+    CLASS,              // u16 class             [super]    ->
+    PUSH_SCOPE,         // u16 slots, u8 escapes
+    POP_SCOPE,
+    RETURN,             // u16 keyword           value      ->
+    END,                // implicit return at the end of a function body
+    HALT
+};
+
+// Operand value meaning "no variable" / "global" in CALL and DEFINE.
+constexpr uint16_t NO_OPERAND = 0xFFFF;
+
+enum class StepTarget : uint8_t {
+    VARIABLE,
+    LITERAL,
+    OTHER
+};
+
+class Chunk {
+    public:
+        std::vector<uint8_t> code;
+        std::vector<RuntimeValue> constants;
+        std::vector<Token> tokens;
+        // Inline caches of the AST sites this chunk was compiled from.
+        std::vector<InlineCache*> caches;
+        // Calls the Inliner replaced, for their checks and conversions.
+        std::vector<InlineExpr*> inlines;
+        FunctionStmt* declaration = nullptr;
+
+        void write(OpCode op) {
+            code.push_back(static_cast<uint8_t>(op));
+        }
+
+        void writeByte(uint8_t byte) {
+            code.push_back(byte);
+        }
+
+        void writeShort(uint16_t value) {
+            code.push_back(value & 0xFF);
+            code.push_back((value >> 8) & 0xFF);
+        }
+
+        uint16_t readShort(size_t offset) const {
+            return code[offset] | (code[offset + 1] << 8);
+        }
+
+        void patchShort(size_t offset, uint16_t value) {
+            code[offset] = value & 0xFF;
+            code[offset + 1] = (value >> 8) & 0xFF;
+        }
+
+        uint16_t addConstant(const RuntimeValue& value) {
+            constants.push_back(value);
+            return constants.size() - 1;
+        }
+
+        uint16_t addToken(const Token& token) {
+            tokens.push_back(token);
+            return tokens.size() - 1;
+        }
+
+        uint16_t addCache(InlineCache& cache) {
+            caches.push_back(&cache);
+            return caches.size() - 1;
+        }
+
+        uint16_t addInline(InlineExpr& expr) {
+            inlines.push_back(&expr);
+            return inlines.size() - 1;
+        }
+};
+
+class ClassProto {
+    public:
+        ClassStmt* declaration;
+        std::vector<const Chunk*> methods;
+};
+
+class Program {
+    public:
+        Chunk script;
+        std::vector<std::unique_ptr<Chunk>> functions;
+        std::vector<ClassProto> classes;
+};
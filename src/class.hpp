@@ -2,41 +2,88 @@
 
 #include "callable.hpp"
 #include "function.hpp"
+#include "inlineCache.hpp"
 #include "util.hpp"
 #include <unordered_map>
+#include <vector>
 
 class Class : public Callable {
     public:
         std::string name;
-        std::shared_ptr<Class> superclass;
-        std::unordered_map<std::string,std::shared_ptr<Function>> methods;
+        Ref<Class> superclass;
+        // Every method the class responds to, inherited ones included,
+        // copied down when the class is created. An override keeps the
+        // index of the method it replaces, so indices are stable down a
+        // hierarchy.
+        std::vector<Ref<Function>> methods;
+        std::unordered_map<std::string,uint32_t> methodIndex;
+        Ref<Function> initializer;
+        int initArity = 0;
+        // Identifies the class to inline caches.
+        uint32_t id;
 
-        Class() {}
+        Class() : Callable(TypeTag::CLASS), id(nextId()) {}
 
-        Class(std::string name,std::shared_ptr<Class> superclass,std::unordered_map<std::string,std::shared_ptr<Function>>& methods) :
-            name(name), superclass(superclass), methods(methods) {}
+        Class(std::string name,Ref<Class> superclass,const std::unordered_map<std::string,Ref<Function>>& declared) :
+            Callable(TypeTag::CLASS), name(name), superclass(superclass), id(nextId()) {
+            if(superclass != nullptr) {
+                methods = superclass->methods;
+                methodIndex = superclass->methodIndex;
+            }
+            for(auto& [methodName,method] : declared) {
+                auto [index,added] = methodIndex.emplace(methodName,methods.size());
+                if(added) methods.push_back(method);
+                else methods[index->second] = method;
+            }
+
+            initializer = findMethod("init");
+            if(initializer != nullptr) initArity = initializer->arity();
+        }
+
+        // Instances and subclasses share the one Class by reference.
+        Class(const Class&) = delete;
+        Class& operator=(const Class&) = delete;
+
+        static uint32_t nextId() {
+            static uint32_t next = 0;
+            return ++next;
+        }
+
+        // findMethod through a call site's cache.
+        Function* findMethod(const std::string& name,InlineCache& cache) {
+            uint64_t key = InlineCache::key(0,id);
+            if(const InlineCache::Entry* entry = cache.find(key)) return entry->method;
+
+            Function* method = findMethod(name).get();
+            if(method != nullptr) cache.add({key,-1,method});
+            return method;
+        }
 
         std::string toString() const override {
             return "<class " + name + ">";
         }
 
-        std::shared_ptr<Function> findMethod(std::string name) {
-            if(methods.contains(name)) {
-                return methods[name];
-            }
+        void trace(const Tracer& tracer) const override {
+            if(superclass != nullptr) tracer(superclass.get());
+            for(auto& method : methods) tracer(method.get());
+        }
 
-            if(superclass != nullptr) {
-                return superclass->findMethod(name);
-            }
+        void clear() override {
+            superclass = nullptr;
+            methods.clear();
+            methodIndex.clear();
+            initializer = nullptr;
+        }
 
-            return nullptr;
+        Ref<Function> findMethod(const std::string& name) const {
+            auto index = methodIndex.find(name);
+            if(index == methodIndex.end()) return nullptr;
+            return methods[index->second];
         }
 
-        RuntimeValue call(Interpreter& interpreter, const Token& name,const std::vector<Expression>& exprs) override;
+        RuntimeValue callValues(Interpreter& interpreter, const Token& name,std::vector<RuntimeValue> args) override;
 
         int arity() override{
-            std::shared_ptr<Function> initializer = findMethod("init");
-            if(initializer == nullptr) return 0;
-            return initializer->arity();
+            return initArity;
         }
 };
@@ -0,0 +1,466 @@
+#pragma once
+
+#include "chunk.hpp"
+#include "expr.hpp"
+#include "interpreter.hpp"
+#include "stmt.hpp"
+#include "tokenType.hpp"
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+class Compiler : public ExprVisitor, public StmtVisitor {
+    private:
+        Interpreter& interpreter;
+        Program* program = nullptr;
+        Chunk* chunk = nullptr;
+
+        void compile(const Statement& stmt) {
+            stmt->accept(*this);
+        }
+
+        void compile(const Expression& expr) {
+            expr->accept(*this);
+        }
+
+        void compileBlock(const std::vector<Statement>& stmts) {
+            for(auto& stmt : stmts) {
+                compile(stmt);
+            }
+        }
+
+        void emit(OpCode op) {
+            chunk->write(op);
+        }
+
+        void emit(OpCode op, uint16_t operand) {
+            chunk->write(op);
+            chunk->writeShort(operand);
+        }
+
+        uint16_t token(const Token& token) {
+            return chunk->addToken(token);
+        }
+
+        size_t emitJump(OpCode op) {
+            chunk->write(op);
+            chunk->writeShort(0xFFFF);
+            return chunk->code.size() - 2;
+        }
+
+        void patchJump(size_t offset) {
+            size_t jump = chunk->code.size() - offset - 2;
+            if(jump > std::numeric_limits<uint16_t>::max())
+                throw std::overflow_error("Too much code to jump over.");
+            chunk->patchShort(offset,jump);
+        }
+
+        void emitLoop(size_t start) {
+            chunk->write(OpCode::LOOP);
+            size_t offset = chunk->code.size() - start + 2;
+            if(offset > std::numeric_limits<uint16_t>::max())
+                throw std::overflow_error("Loop body too large.");
+            chunk->writeShort(offset);
+        }
+
+        void emitGet(const Token& name,int depth,int slot) {
+            if(depth >= 0) {
+                emit(OpCode::GET_LOCAL,depth);
+                chunk->writeShort(slot);
+            } else {
+                emit(OpCode::GET_GLOBAL,token(name));
+            }
+        }
+
+        void emitSet(const Token& name,int depth,int slot) {
+            if(depth >= 0) {
+                emit(OpCode::SET_LOCAL,depth);
+                chunk->writeShort(slot);
+            } else {
+                emit(OpCode::SET_GLOBAL,token(name));
+            }
+        }
+
+        uint16_t slotOperand(int slot) {
+            return slot < 0 ? NO_OPERAND : slot;
+        }
+
+        const Chunk* compileFunction(FunctionStmt& function) {
+            auto code = std::make_unique<Chunk>();
+            code->declaration = &function;
+
+            Chunk* enclosing = chunk;
+            chunk = code.get();
+            compileBlock(function.body);
+            emit(OpCode::END);
+            chunk = enclosing;
+
+            program->functions.push_back(std::move(code));
+            return program->functions.back().get();
+        }
+
+    public:
+        Compiler(Interpreter& interpreter) : interpreter(interpreter) {}
+
+        std::unique_ptr<Program> compile(std::vector<Statement>& statements) {
+            auto result = std::make_unique<Program>();
+            program = result.get();
+            chunk = &program->script;
+
+            compileBlock(statements);
+            emit(OpCode::HALT);
+
+            program = nullptr;
+            chunk = nullptr;
+            return result;
+        }
+
+        RuntimeValue visitBlockStmt(BlockStmt& stmt) override {
+            emit(OpCode::PUSH_SCOPE,stmt.slots);
+            chunk->writeByte(stmt.escapes);
+            compileBlock(stmt.statements);
+            emit(OpCode::POP_SCOPE);
+            return _NIL;
+        }
+
+        RuntimeValue visitClassStmt(ClassStmt& stmt) override {
+            if(stmt.superclass != nullptr) {
+                compile(stmt.superclass);
+            }
+
+            ClassProto proto{&stmt,{}};
+            for(auto& method : stmt.methods) {
+                proto.methods.push_back(compileFunction(method));
+            }
+
+            program->classes.push_back(std::move(proto));
+            emit(OpCode::CLASS,program->classes.size() - 1);
+            return _NIL;
+        }
+
+        RuntimeValue visitExprStmt(ExprStmt& stmt) override {
+            compile(stmt.expression);
+            emit(OpCode::POP);
+            return _NIL;
+        }
+
+        RuntimeValue visitPrintStmt(PrintStmt& stmt) override {
+            compile(stmt.expression);
+            emit(OpCode::PRINT);
+            return _NIL;
+        }
+
+        RuntimeValue visitVarStmt(VarStmt& stmt) override {
+            if(stmt.initializer != nullptr) {
+                compile(stmt.initializer);
+            } else {
+                emit(OpCode::NIL);
+            }
+            emit(OpCode::DEFINE,slotOperand(stmt.slot));
+            chunk->writeShort(token(stmt.name));
+            chunk->writeShort(token(stmt.type));
+            return _NIL;
+        }
+
+        RuntimeValue visitFunctionStmt(FunctionStmt& stmt) override {
+            compileFunction(stmt);
+            emit(OpCode::FUNCTION,program->functions.size() - 1);
+            return _NIL;
+        }
+
+        RuntimeValue visitIfStmt(IfStmt& stmt) override {
+            compile(stmt.ifCondition);
+            size_t thenJump = emitJump(OpCode::JUMP_IF_FALSE);
+            compile(stmt.thenBranch);
+            size_t exitJump = emitJump(OpCode::JUMP);
+            patchJump(thenJump);
+
+            size_t elifExit = 0;
+            bool hasElif = stmt.elifCondition != nullptr;
+            if(hasElif) {
+                compile(stmt.elifCondition);
+                size_t elifJump = emitJump(OpCode::JUMP_IF_FALSE);
+                compile(stmt.elifBranch);
+                elifExit = emitJump(OpCode::JUMP);
+                patchJump(elifJump);
+            }
+
+            if(stmt.elseBranch != nullptr) {
+                compile(stmt.elseBranch);
+            }
+
+            patchJump(exitJump);
+            if(hasElif) patchJump(elifExit);
+            return _NIL;
+        }
+
+        void clearInvariants(int slot,int count) {
+            if(count == 0) return;
+            emit(OpCode::CLEAR_INVARIANTS,slot);
+            chunk->writeShort(count);
+        }
+
+        RuntimeValue visitWhileStmt(WhileStmt& stmt) override {
+            clearInvariants(stmt.invariantSlot,stmt.invariants);
+            size_t loopStart = chunk->code.size();
+            compile(stmt.condition);
+            size_t exitJump = emitJump(OpCode::JUMP_IF_FALSE);
+            compile(stmt.body);
+            emitLoop(loopStart);
+            patchJump(exitJump);
+            return _NIL;
+        }
+
+        RuntimeValue visitForStmt(ForStmt& stmt) override {
+            if(stmt.initializer != nullptr) {
+                compile(stmt.initializer);
+            }
+            clearInvariants(stmt.invariantSlot,stmt.invariants);
+            if(stmt.step != 0) {
+                compileCountedLoop(stmt);
+                return _NIL;
+            }
+
+            size_t loopStart = chunk->code.size();
+            bool hasCondition = stmt.condition != nullptr;
+            size_t exitJump = 0;
+            if(hasCondition) {
+                compile(stmt.condition);
+                exitJump = emitJump(OpCode::JUMP_IF_FALSE);
+            }
+
+            compile(stmt.body);
+            if(stmt.increment != nullptr) {
+                compile(stmt.increment);
+                emit(OpCode::POP);
+            }
+            emitLoop(loopStart);
+
+            if(hasCondition) patchJump(exitJump);
+            return _NIL;
+        }
+
+        // COUNTED_TEST compares the counter with the limit and leaves the
+        // loop; COUNTED_STEP steps a small integer counter and skips the
+        // increment that handles any other value.
+        void compileCountedLoop(ForStmt& stmt) {
+            auto& condition = static_cast<BinaryExpr&>(*stmt.condition);
+            int slot = static_cast<VarStmt&>(*stmt.initializer).slot;
+
+            size_t loopStart = chunk->code.size();
+            compile(condition.right);
+            emit(OpCode::COUNTED_TEST,slot);
+            chunk->writeShort(token(condition.Operator));
+            size_t exitJump = chunk->code.size();
+            chunk->writeShort(0xFFFF);
+
+            compile(stmt.body);
+            emit(OpCode::COUNTED_STEP,slot);
+            chunk->writeShort(chunk->addConstant(stmt.step));
+            size_t stepped = chunk->code.size();
+            chunk->writeShort(0xFFFF);
+            compile(stmt.increment);
+            emit(OpCode::POP);
+            patchJump(stepped);
+            emitLoop(loopStart);
+
+            patchJump(exitJump);
+        }
+
+        RuntimeValue visitReturnStmt(ReturnStmt& stmt) override {
+            if(stmt.value != nullptr) {
+                compile(stmt.value);
+            } else {
+                emit(OpCode::NIL);
+            }
+            emit(OpCode::RETURN,token(stmt.keyword));
+            return _NIL;
+        }
+
+        RuntimeValue visitAssignExpr(AssignExpr& expr) override {
+            compile(expr.value);
+            emitSet(expr.name,expr.depth,expr.slot);
+            return _NIL;
+        }
+
+        RuntimeValue visitBinaryExpr(BinaryExpr& expr) override {
+            compile(expr.left);
+            compile(expr.right);
+            emit(OpCode::BINARY,token(expr.Operator));
+            return _NIL;
+        }
+
+        RuntimeValue visitCallExpr(CallExpr& expr) override {
+            // obj.method(...) leaves obj under the arguments and calls the
+            // method unbound; see VM::invokeMethod.
+            auto get = dynamic_cast<GetExpr*>(expr.callee.get());
+            compile(get != nullptr ? get->object : expr.callee);
+            for(auto& argument : expr.arguments) {
+                compile(argument);
+            }
+
+            // typeOf() reports the declared type of a variable argument, so the
+            // call site records where that variable lives.
+            uint16_t argVariable = NO_OPERAND;
+            uint16_t argDepth = NO_OPERAND;
+            uint16_t argSlot = NO_OPERAND;
+            if(expr.arguments.size() == 1) {
+                if(auto varExpr = dynamic_cast<VariableExpr*>(expr.arguments[0].get())) {
+                    argVariable = token(varExpr->name);
+                    if(varExpr->depth >= 0) {
+                        argDepth = varExpr->depth;
+                        argSlot = varExpr->slot;
+                    }
+                }
+            }
+
+            if(get != nullptr) {
+                emit(OpCode::INVOKE,token(get->name));
+                chunk->writeShort(chunk->addCache(get->cache));
+            } else {
+                emit(OpCode::CALL);
+            }
+            chunk->writeByte(expr.arguments.size());
+            chunk->writeShort(token(expr.name));
+            chunk->writeShort(token(expr.paren));
+            chunk->writeShort(argVariable);
+            chunk->writeShort(argDepth);
+            chunk->writeShort(argSlot);
+            return _NIL;
+        }
+
+        RuntimeValue visitInlineExpr(InlineExpr& expr) override {
+            for(auto& argument : expr.arguments) {
+                compile(argument);
+            }
+            uint16_t index = chunk->addInline(expr);
+            emit(OpCode::INLINE_ARGS,index);
+            compile(expr.body);
+            emit(OpCode::INLINE_RETURN,index);
+            return _NIL;
+        }
+
+        // Pushes the cached value and skips the expression, or evaluates
+        // it and caches the result.
+        RuntimeValue visitInvariantExpr(InvariantExpr& expr) override {
+            emit(OpCode::GET_INVARIANT,expr.depth);
+            chunk->writeShort(expr.slot);
+            size_t cached = chunk->code.size();
+            chunk->writeShort(0xFFFF);
+            compile(expr.expression);
+            emit(OpCode::SET_INVARIANT,expr.depth);
+            chunk->writeShort(expr.slot);
+            patchJump(cached);
+            return _NIL;
+        }
+
+        RuntimeValue visitUnaryExpr(UnaryExpr& expr) override {
+            compile(expr.right);
+            switch(expr.Operator.type) {
+                case TokenType::PRE_INCR :
+                case TokenType::POST_INCR :
+                case TokenType::PRE_DECR :
+                case TokenType::POST_DECR :
+                    {
+                        auto varExpr = dynamic_cast<VariableExpr*>(expr.right.get());
+                        StepTarget target = StepTarget::OTHER;
+                        if(varExpr != nullptr) {
+                            target = StepTarget::VARIABLE;
+                        } else if(dynamic_cast<LiteralExpr*>(expr.right.get())) {
+                            target = StepTarget::LITERAL;
+                        }
+                        emit(OpCode::STEP,token(expr.Operator));
+                        chunk->writeByte(static_cast<uint8_t>(target));
+
+                        // STEP leaves the expression's result under the stepped
+                        // value; store the latter back and drop it.
+                        if(varExpr != nullptr) {
+                            emitSet(varExpr->name,varExpr->depth,varExpr->slot);
+                            emit(OpCode::POP);
+                        }
+                    }
+                    break;
+
+                default:
+                    emit(OpCode::UNARY,token(expr.Operator));
+            }
+            return _NIL;
+        }
+
+        RuntimeValue visitGroupingExpr(GroupingExpr& expr) override {
+            compile(expr.expression);
+            return _NIL;
+        }
+
+        RuntimeValue visitGetExpr(GetExpr& expr) override {
+            compile(expr.object);
+            emit(OpCode::GET_PROPERTY,token(expr.name));
+            chunk->writeShort(chunk->addCache(expr.cache));
+            return _NIL;
+        }
+
+        RuntimeValue visitSetExpr(SetExpr& expr) override {
+            compile(expr.object);
+            compile(expr.value);
+            emit(OpCode::SET_PROPERTY,token(expr.name));
+            chunk->writeShort(chunk->addCache(expr.cache));
+            return _NIL;
+        }
+
+        RuntimeValue visitSuperExpr(SuperExpr& expr) override {
+            emit(OpCode::GET_SUPER,expr.depth);
+            chunk->writeShort(token(expr.method));
+            chunk->writeShort(chunk->addCache(expr.cache));
+            return _NIL;
+        }
+
+        RuntimeValue visitThisExpr(ThisExpr& expr) override {
+            emitGet(expr.keyword,expr.depth,expr.slot);
+            return _NIL;
+        }
+
+        RuntimeValue visitLiteralExpr(LiteralExpr& expr) override {
+            emit(OpCode::CONSTANT,chunk->addConstant(expr.literal));
+            return _NIL;
+        }
+
+        RuntimeValue visitLogicalExpr(LogicalExpr& expr) override {
+            compile(expr.left);
+
+            switch(expr.Operator.type) {
+                case TokenType::OR:
+                case TokenType::AND:
+                    {
+                        size_t shortCircuit = emitJump(expr.Operator.type == TokenType::OR
+                                ? OpCode::JUMP_IF_TRUE_KEEP : OpCode::JUMP_IF_FALSE_KEEP);
+                        emit(OpCode::POP);
+                        compile(expr.right);
+                        patchJump(shortCircuit);
+                    }
+                    break;
+
+                case TokenType::PIPE_PIPE:
+                case TokenType::AMP_AMP:
+                    {
+                        emit(OpCode::TRUTHY);
+                        size_t shortCircuit = emitJump(expr.Operator.type == TokenType::PIPE_PIPE
+                                ? OpCode::JUMP_IF_TRUE_KEEP : OpCode::JUMP_IF_FALSE_KEEP);
+                        emit(OpCode::POP);
+                        compile(expr.right);
+                        emit(OpCode::TRUTHY);
+                        patchJump(shortCircuit);
+                    }
+                    break;
+
+                default:
+                    throw RuntimeError(expr.Operator,"Invalid logical operator.");
+            }
+            return _NIL;
+        }
+
+        RuntimeValue visitVariableExpr(VariableExpr& expr) override {
+            emitGet(expr.name,expr.depth,expr.slot);
+            return _NIL;
+        }
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "loopInvariants.hpp"
+#include <limits>
+
+// Marks counted loops, which both engines run with a machine-word counter:
+//
+//   for(<type> i = <start>; i <op> <limit>; <increment>) <body>
+//
+// where i is a local, <op> is <, <=, >, >= or !=, and <increment> is i++,
+// ++i, i--, --i, i += k, i -= k, i = i + k or i = i - k for an integer
+// literal k. Neither the condition nor the body may assign i, or declare
+// a function or class (only a closure could let a call assign it). Locals
+// the body's block declares live in a frame of their own, so they never
+// stand for i even when they share its slot number. The loop's 'step' is
+// set to the amount the increment adds to i.
+//
+// While i and the limit are small integers they are compared and i is
+// stepped in place; any other value goes through the condition's operator
+// or the increment as usual, so a counter that outgrows a small integer
+// carries on as an Integer.
+class CountedLoops : public OptimizerPass {
+    private:
+        static bool isCounter(const Expression& expr,int slot) {
+            auto variable = dynamic_cast<VariableExpr*>(expr.get());
+            return variable != nullptr && variable->depth == 0 && variable->slot == slot;
+        }
+
+        // What the increment adds to local 'slot', or 0 if it is not a step.
+        static int stepOf(const Expression& increment,int slot) {
+            if(auto unary = dynamic_cast<UnaryExpr*>(increment.get())) {
+                if(!isCounter(unary->right,slot)) return 0;
+                switch(unary->Operator.type) {
+                    case TokenType::PRE_INCR:
+                    case TokenType::POST_INCR:
+                        return 1;
+                    case TokenType::PRE_DECR:
+                    case TokenType::POST_DECR:
+                        return -1;
+                    default:
+                        return 0;
+                }
+            }
+
+            auto assign = dynamic_cast<AssignExpr*>(increment.get());
+            if(assign == nullptr || assign->depth != 0 || assign->slot != slot) return 0;
+            auto sum = dynamic_cast<BinaryExpr*>(assign->value.get());
+            if(sum == nullptr || !isCounter(sum->left,slot)) return 0;
+            LiteralExpr* amount = literal(sum->right);
+            if(amount == nullptr || !amount->literal.isSmallInt()) return 0;
+
+            int k = amount->literal.asSmallInt();
+            if(sum->Operator.type == TokenType::PLUS) return k;
+            if(sum->Operator.type == TokenType::MINUS && k != std::numeric_limits<int>::min()) return -k;
+            return 0;
+        }
+
+        static bool comparison(TokenType type) {
+            switch(type) {
+                case TokenType::LESS:
+                case TokenType::LESS_EQUAL:
+                case TokenType::GREATER:
+                case TokenType::GREATER_EQUAL:
+                case TokenType::BANG_EQUAL:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+    public:
+        using OptimizerPass::OptimizerPass;
+
+        RuntimeValue visitForStmt(ForStmt& stmt) override {
+            OptimizerPass::visitForStmt(stmt);
+
+            auto counter = dynamic_cast<VarStmt*>(stmt.initializer.get());
+            auto condition = dynamic_cast<BinaryExpr*>(stmt.condition.get());
+            if(counter == nullptr || counter->slot < 0 || condition == nullptr) return _NIL;
+            if(!comparison(condition->Operator.type) || !isCounter(condition->left,counter->slot)) return _NIL;
+            int step = stepOf(stmt.increment,counter->slot);
+            if(step == 0) return _NIL;
+
+            LoopEffects effects(interpreter);
+            effects.scan(stmt.condition);
+            effects.scan(stmt.body);
+            if(effects.declares || effects.assignedLocals.contains({0,counter->slot})) return _NIL;
+
+            stmt.step = step;
+            return _NIL;
+        }
+};
@@ -1,36 +1,48 @@
 #pragma once
 #include "token.hpp"
+#include <memory>
 #include <unordered_map>
+#include <vector>
 #include "error.hpp"
+#include "heap.hpp"
 #include "util.hpp"
 
 
-class Environment{
+// Globals are looked up by name in 'values'. Every local scope is a flat
+// frame: the Resolver gives each local a slot index and each scope its
+// size, so a local is reached by hopping 'distance' frames up and indexing.
+class Environment : public GcObj {
     public:
-        Environment* enclosing;
-        std::unordered_map<std::string, std::pair<RuntimeValue,std::string>> values;
+        Ref<Environment> enclosing;
+        std::unordered_map<std::string, std::pair<RuntimeValue,TypeTag>> values;
+        std::vector<std::pair<RuntimeValue,TypeTag>> slots;
+        // Owned by a FrameArena rather than the heap.
+        bool pooled = false;
 
 
-        Environment() : enclosing(nullptr) {}
+        Environment() : GcObj(TypeTag::ENVIRONMENT) {}
 
-        Environment(Environment* enclosing) : enclosing(enclosing) {}
+        Environment(Ref<Environment> enclosing,size_t size = 0) :
+            GcObj(TypeTag::ENVIRONMENT), enclosing(std::move(enclosing)), slots(size) {}
 
-        void define(std::string name,RuntimeValue value,std::string type){
-            if(type == "var") type = "variable";
-            else if(type == "int") type = "integer";
-            values[name] = {value,type};
+        void define(const std::string& name,RuntimeValue value,TypeTag type){
+            values[name] = {std::move(value),type};
+        }
+
+        void defineAt(int slot,RuntimeValue value,TypeTag type){
+            slots[slot] = {std::move(value),type};
         }
 
         Environment* ancestor(int distance) {
             Environment* environment = this;
             for(int i=0;i<distance;i++){
-                environment = environment->enclosing;
+                environment = environment->enclosing.get();
             }
 
             return environment;
         }
 
-        RuntimeValue get(Token name){
+        RuntimeValue get(const Token& name){
             if(values.contains(name.lexeme)){
                 return values.at(name.lexeme).first;
             }
@@ -40,11 +52,11 @@ class Environment{
             throw RuntimeError(name, "Undefined Variable '" + name.lexeme +"'.");
         }
 
-        RuntimeValue getAt(int distance,std::string name) {
-            return ancestor(distance)->values.at(name).first;
+        const RuntimeValue& getAt(int distance,int slot) {
+            return ancestor(distance)->slots[slot].first;
         }
 
-        std::string getType(Token name){
+        TypeTag getType(const Token& name){
             if(values.contains(name.lexeme)){
                 return values.at(name.lexeme).second;
             }
@@ -54,27 +66,26 @@ class Environment{
             throw RuntimeError(name, "Undefined Variable '" + name.lexeme +"'.");
         }
 
-        std::string getTypeAt(int distance,Token name) {
-            return ancestor(distance)->values.at(name.lexeme).second;
+        TypeTag getTypeAt(int distance,int slot) {
+            return ancestor(distance)->slots[slot].second;
         }
 
-        void assignAt(int distance,Token name,RuntimeValue value) {
-            ancestor(distance)->values[name.lexeme].first = value;
+        void assignAt(int distance,int slot,RuntimeValue value) {
+            ancestor(distance)->slots[slot].first = std::move(value);
         }
 
-        void assign(Token name,RuntimeValue value){
+        void assign(const Token& name,RuntimeValue value){
             if(values.contains(name.lexeme)){
-                LiteralValue val = getLiteralValue(value);
-                if(val == _NIL) {
+                if(value.isNil()) {
                     values[name.lexeme].first = value;
                     return;
                 }
-                std::string type = values[name.lexeme].second;
-                if(type == val.second || type == "variable"){
+                TypeTag type = values[name.lexeme].second;
+                if(type == value.typeTag() || type == TypeTag::VARIABLE){
                     values[name.lexeme].first = value;
                     return;
                 }
-                throw RuntimeError(name,"Cannot convert '" + val.second + "' to '"+type+"'");
+                throw RuntimeError(name,"Cannot convert '" + typeName(value.typeTag()) + "' to '"+typeName(type)+"'");
             }
 
             if(enclosing != nullptr){ 
@@ -85,35 +96,44 @@ class Environment{
             throw RuntimeError(name,"Undefined variable '"+name.lexeme+"'.");
         }
 
+        static std::string valueString(const RuntimeValue& value,TypeTag type) {
+            switch (value.isNil() ? TypeTag::NIL : type) {
+                case TypeTag::INTEGER:     return value.asInteger().toString();
+                case TypeTag::DECIMAL:     return cleanDouble(value.asDecimal());
+                case TypeTag::BIG_DECIMAL: return value.asBigDecimal().toString();
+                case TypeTag::BOOLEAN:     return value.asBool() ? "true" : "false";
+                case TypeTag::STRING:      return "'" + value.asString() + "'";
+                case TypeTag::FUNCTION:    return "<function>";
+                case TypeTag::CLASS:       return "<class>";
+                case TypeTag::NIL:         return "nil";
+                default:                   return "<unknown>";
+            }
+        }
+
+        void trace(const Tracer& tracer) const override {
+            if(enclosing != nullptr) tracer(enclosing.get());
+            for(auto& [name,entry] : values) traceValue(entry.first,tracer);
+            for(auto& entry : slots) traceValue(entry.first,tracer);
+        }
+
+        void clear() override {
+            enclosing = nullptr;
+            values.clear();
+            slots.clear();
+        }
+
         std::string toString(int depth = 0) const {
             std::string indent(depth * 2, ' ');
             std::string result = indent + "Environment (Depth " + std::to_string(depth) + "):\n";
 
             for (const auto& [name, valueTypePair] : values) {
                 const auto& [value, type] = valueTypePair;
-                std::string valStr;
-
-                if (type == "integer") {
-                    valStr = std::get<Integer>(getLiteralValue(value).first).toString();
-                } else if (type == "decimal") {
-                    valStr = cleanDouble(std::get<double>(getLiteralValue(value).first));
-                } else if (type == "BigDecimal") {
-                    valStr = std::get<BigDecimal>(getLiteralValue(value).first).toString();
-                } else if (type == "boolean") {
-                    valStr = std::get<bool>(getLiteralValue(value).first) ? "true" : "false";
-                } else if (type == "string") {
-                    valStr = "'" + std::get<std::string>((getLiteralValue(value).first)) + "'";
-                } else if (type == "function") {
-                    valStr = "<function>";
-                } else if(type == "class") {
-                    valStr = "<class>";
-                } else if (type == "nil") {
-                    valStr = "nil";
-                } else {
-                    valStr = "<unknown>";
-                }
+                result += indent + "  " + name + " : (" + typeName(type) + ") = " + valueString(value,type) + "\n";
+            }
 
-                result += indent + "  " + name + " : (" + type + ") = " + valStr + "\n";
+            for (size_t slot = 0; slot < slots.size(); slot++) {
+                const auto& [value, type] = slots[slot];
+                result += indent + "  #" + std::to_string(slot) + " : (" + typeName(type) + ") = " + valueString(value,type) + "\n";
             }
 
             if (enclosing) {
@@ -126,19 +146,69 @@ class Environment{
 
 };
 
+// Hands out Environments in LIFO order and reuses them, so a block or call
+// whose scope no closure captures costs no allocation once the arena has
+// grown to the program's nesting depth.
+class FrameArena {
+    private:
+        std::vector<Ref<Environment>> frames;
+        size_t top = 0;
+
+    public:
+        Environment* acquire(const Ref<Environment>& enclosing,size_t size) {
+            if(top == frames.size()) frames.push_back(makeRef<Environment>());
+            Environment* frame = frames[top++].get();
+            frame->enclosing = enclosing;
+            frame->slots.resize(size);
+            frame->pooled = true;
+            return frame;
+        }
+
+        size_t mark() const {
+            return top;
+        }
+
+        // Releases every frame acquired after the mark, dropping their values.
+        void releaseTo(size_t mark) {
+            while(top > mark) {
+                Environment* frame = frames[--top].get();
+                frame->slots.clear();
+                frame->enclosing = nullptr;
+            }
+        }
+
+        // Releases the newest frame; heap Environments (and null) are left alone.
+        void release(Environment* frame) {
+            if(frame != nullptr && frame->pooled) releaseTo(top - 1);
+        }
+};
+
 class EnvSwitch {
-    Environment*& target;
-    Environment* previous;
+    Ref<Environment>& target;
+    Ref<Environment> previous;
 
 public:
-    EnvSwitch(Environment*& target, Environment*& newEnv)
+    EnvSwitch(Ref<Environment>& target, Environment* newEnv)
         : target(target), previous(target)
     {
         target = newEnv;
     }
 
     ~EnvSwitch() {
-        target = previous;
+        target = std::move(previous);
     }
 };
 
+
+class FrameRelease {
+    FrameArena& arena;
+    Environment* frame;
+
+public:
+    FrameRelease(FrameArena& arena, Environment* frame)
+        : arena(arena), frame(frame) {}
+
+    ~FrameRelease() {
+        arena.release(frame);
+    }
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "token.hpp"
+#include "inlineCache.hpp"
 #include <vector>
 #include <memory>
 
@@ -17,6 +18,8 @@ class ThisExpr;
 class LiteralExpr;
 class LogicalExpr;
 class VariableExpr;
+class InlineExpr;
+class InvariantExpr;
 
 using Expression = std::unique_ptr<Expr>;
 
@@ -39,6 +42,8 @@ public:
 	virtual RuntimeValue visitLiteralExpr(LiteralExpr& expr) = 0;
 	virtual RuntimeValue visitLogicalExpr(LogicalExpr& expr) = 0;
 	virtual RuntimeValue visitVariableExpr(VariableExpr& expr) = 0;
+	virtual RuntimeValue visitInlineExpr(InlineExpr& expr) = 0;
+	virtual RuntimeValue visitInvariantExpr(InvariantExpr& expr) = 0;
 	virtual ~ExprVisitor() = default;
 };
 
@@ -53,6 +58,8 @@ public:
 	Token name;
 	Token Operator;
 	Expression value;
+	int depth = -1;
+	int slot = -1;
 
 	AssignExpr(Token name, Token Operator, Expression value) : name(name), Operator(Operator), value(std::move(value)) {}
 	RuntimeValue accept(ExprVisitor& visitor) override {
@@ -110,6 +117,7 @@ class GetExpr : public Expr {
 public:
 	Expression object;
 	Token name;
+	InlineCache cache = {};
 
 	GetExpr(Expression object, Token name) : object(std::move(object)), name(name) {}
 	RuntimeValue accept(ExprVisitor& visitor) override {
@@ -122,6 +130,7 @@ public:
 	Expression object;
 	Token name;
 	Expression value;
+	InlineCache cache = {};
 
 	SetExpr(Expression object, Token name, Expression value) : object(std::move(object)), name(name), value(std::move(value)) {}
 	RuntimeValue accept(ExprVisitor& visitor) override {
@@ -133,6 +142,9 @@ class SuperExpr : public Expr {
 public:
 	Token keyword;
 	Token method;
+	int depth = -1;
+	int slot = -1;
+	InlineCache cache = {};
 
 	SuperExpr(Token keyword, Token method) : keyword(keyword), method(method) {}
 	RuntimeValue accept(ExprVisitor& visitor) override {
@@ -143,6 +155,8 @@ public:
 class ThisExpr : public Expr {
 public:
 	Token keyword;
+	int depth = -1;
+	int slot = -1;
 
 	ThisExpr(Token keyword) : keyword(keyword) {}
 	RuntimeValue accept(ExprVisitor& visitor) override {
@@ -152,9 +166,9 @@ public:
 
 class LiteralExpr : public Expr {
 public:
-	LiteralValue literal;
+	RuntimeValue literal;
 
-	LiteralExpr(LiteralValue literal) : literal(literal) {}
+	LiteralExpr(RuntimeValue literal) : literal(literal) {}
 	RuntimeValue accept(ExprVisitor& visitor) override {
 		return visitor.visitLiteralExpr(*this);
 	}
@@ -175,6 +189,8 @@ public:
 class VariableExpr : public Expr {
 public:
 	Token name;
+	int depth = -1;
+	int slot = -1;
 
 	VariableExpr(Token name) : name(name) {}
 	RuntimeValue accept(ExprVisitor& visitor) override {
@@ -182,6 +198,34 @@ public:
 	}
 };
 
+class InlineExpr : public Expr {
+public:
+	Token name;
+	std::vector<Expression> arguments;
+	std::vector<TypeTag> types;
+	Expression body;
+	Token keyword;
+	Token returnType;
+	int slot = -1;
+
+	InlineExpr(Token name, std::vector<Expression> arguments, std::vector<TypeTag> types, Expression body, Token keyword, Token returnType) : name(name), arguments(std::move(arguments)), types(types), body(std::move(body)), keyword(keyword), returnType(returnType) {}
+	RuntimeValue accept(ExprVisitor& visitor) override {
+		return visitor.visitInlineExpr(*this);
+	}
+};
+
+class InvariantExpr : public Expr {
+public:
+	Expression expression;
+	int depth = -1;
+	int slot = -1;
+
+	InvariantExpr(Expression expression) : expression(std::move(expression)) {}
+	RuntimeValue accept(ExprVisitor& visitor) override {
+		return visitor.visitInvariantExpr(*this);
+	}
+};
+
 std::string getTypeOfExpression(const Expression& expr) {
 	if (auto assignexpr = dynamic_cast<AssignExpr*>(expr.get())) {
 		return "Assign Expression";
@@ -207,6 +251,10 @@ std::string getTypeOfExpression(const Expression& expr) {
 		return "Logical Expression";
 	} else if (auto variableexpr = dynamic_cast<VariableExpr*>(expr.get())) {
 		return "Variable Expression";
+	} else if (auto inlineexpr = dynamic_cast<InlineExpr*>(expr.get())) {
+		return "Inline Expression";
+	} else if (auto invariantexpr = dynamic_cast<InvariantExpr*>(expr.get())) {
+		return "Invariant Expression";
 	}
 	return "Unknown Expression";
 }
\ No newline at end of file
@@ -6,29 +6,65 @@
 #include "return.hpp"
 #include "util.hpp"
 
+class Chunk;
+
 class Function : public Callable {
     private:
         FunctionStmt& declaration;
-        Environment* closure;
+        Ref<Environment> closure;
         bool isInitializer;
+        TypeTag returnType;
 
     public:
-        Function(FunctionStmt& declaration,Environment*& closure,bool isInitializer) :
-            declaration(declaration), closure(closure), isInitializer(isInitializer) {}
+        const Chunk* code = nullptr;
+
+        Function(FunctionStmt& declaration,Ref<Environment> closure,bool isInitializer,const Chunk* code = nullptr) :
+            declaration(declaration), closure(closure), isInitializer(isInitializer),
+            returnType(typeTagOf(declaration.returnType.lexeme)), code(code) {}
         
         int arity() override {
             return declaration.params.size();
         }
 
-        RuntimeValue call(Interpreter& interpreter, const Token& name,const std::vector<Expression>& exprs) override;
+        RuntimeValue callValues(Interpreter& interpreter, const Token& name,std::vector<RuntimeValue> args) override;
+
+        // Runs the body with evaluated arguments. Tail calls to other Dharma
+        // functions run in this loop, so they take no native stack.
+        //
+        // A method can be run unbound by passing the instance as receiver:
+        // 'this' then lives in a frame of the call rather than in a bound
+        // Function's closure. Receivers are never nil, so nil means none.
+        RuntimeValue invoke(Interpreter& interpreter,const Token& name,std::vector<RuntimeValue> args,const RuntimeValue& receiver = _NIL);
+
+        Environment* bindArguments(Interpreter& interpreter,const Token& name,const std::vector<RuntimeValue>& args,const RuntimeValue& receiver = _NIL);
+
+        RuntimeValue returnValue(Interpreter& interpreter,const Token& keyword,const RuntimeValue& value,const RuntimeValue& receiver = _NIL);
+
+        RuntimeValue implicitReturn(const RuntimeValue& receiver = _NIL) {
+            if(isInitializer) return self(receiver);
+            return _NIL;
+        }
 
-        std::shared_ptr<Function> bind(Instance instance) {
-            Environment* environment = new Environment(closure);
-            environment->define("this",instance,"class");
-            return makeShared<Function>(declaration,environment,isInitializer);
+        // The instance an initializer returns.
+        RuntimeValue self(const RuntimeValue& receiver) const {
+            return receiver.isNil() ? closure->getAt(0,0) : receiver;
+        }
+
+        Ref<Function> bind(Instance instance) {
+            Environment* environment = new Environment(closure,1);
+            environment->defineAt(0,instance,TypeTag::CLASS);
+            return makeRef<Function>(declaration,environment,isInitializer,code);
         }
 
         std::string toString() const override {
             return "<fn " + declaration.name.lexeme + " >";
         }
+
+        void trace(const Tracer& tracer) const override {
+            if(closure != nullptr) tracer(closure.get());
+        }
+
+        void clear() override {
+            closure = nullptr;
+        }
 };
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "value.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class GcObj;
+
+using Tracer = std::function<void(GcObj*)>;
+
+// An Obj that can hold references to other Objs and so can be part of a
+// reference cycle (closures, classes, instances, environments). Every live
+// one is linked into the Heap, which finds the cycles reference counting
+// alone never frees.
+class GcObj : public Obj {
+    public:
+        GcObj* prev = nullptr;
+        GcObj* next = nullptr;
+        int64_t gcRefs = 0;
+        bool reachable = false;
+
+        GcObj(TypeTag type);
+        GcObj(const GcObj& other);
+        GcObj& operator=(const GcObj&) { return *this; }
+        ~GcObj() override;
+
+        // Reports every GcObj this one holds a counted reference to.
+        virtual void trace(const Tracer&) const {}
+
+        // Drops those references, to take a garbage cycle apart.
+        virtual void clear() {}
+};
+
+constexpr bool isContainer(TypeTag tag) {
+    return tag == TypeTag::FUNCTION || tag == TypeTag::CLASS || tag == TypeTag::INSTANCE || tag == TypeTag::ENVIRONMENT;
+}
+
+inline void traceValue(const Value& value,const Tracer& tracer) {
+    Obj* object = value.object();
+    if(object != nullptr && isContainer(object->type)) tracer(static_cast<GcObj*>(object));
+}
+
+// Mark-sweep collector over every GcObj.
+//
+// Roots need no registration: an object whose refCount is higher than the
+// number of references it receives from other GcObjs is held from outside
+// the heap (the interpreter's globals and current environment, the frame
+// arena, the VM stack, a temporary on the C++ stack) and is live. Whatever
+// those roots cannot reach is garbage, however many references it holds
+// to itself.
+//
+// Collection only happens at safe points (Interpreter::execute, the VM's
+// CALL and LOOP), once enough GcObjs have been allocated since the last
+// run. The threshold is the configured target or the surviving heap size,
+// whichever is larger, so the collector's cost stays proportional to
+// allocation.
+class Heap {
+    private:
+        GcObj* objects = nullptr;
+        size_t count = 0;
+        size_t allocated = 0;
+        size_t target = DEFAULT_TARGET;
+        size_t threshold = DEFAULT_TARGET;
+
+        Heap() {}
+
+    public:
+        static constexpr size_t DEFAULT_TARGET = 10000;
+
+        // Never destroyed: objects may still unlink themselves during exit.
+        static Heap& instance() {
+            static Heap* heap = new Heap();
+            return *heap;
+        }
+
+        void link(GcObj* object) {
+            object->next = objects;
+            if(objects != nullptr) objects->prev = object;
+            objects = object;
+            count++;
+            allocated++;
+        }
+
+        void unlink(GcObj* object) {
+            if(object->prev != nullptr) object->prev->next = object->next;
+            else objects = object->next;
+            if(object->next != nullptr) object->next->prev = object->prev;
+            count--;
+        }
+
+        void setTarget(size_t objects) {
+            target = std::max<size_t>(objects,1);
+            threshold = std::max(target,count);
+        }
+
+        size_t size() const {
+            return count;
+        }
+
+        void collectIfNeeded() {
+            if(allocated >= threshold) collect();
+        }
+
+        // Returns the number of objects freed.
+        size_t collect() {
+            allocated = 0;
+
+            // An object with no counted references at all is either being
+            // built or is a member of another object (which traces through
+            // it); it is kept and its edges are not subtracted.
+            for(GcObj* object = objects; object != nullptr; object = object->next) {
+                object->gcRefs = object->refCount;
+                object->reachable = false;
+            }
+            for(GcObj* object = objects; object != nullptr; object = object->next) {
+                if(object->refCount > 0) object->trace([](GcObj* child) { child->gcRefs--; });
+            }
+
+            std::vector<GcObj*> worklist;
+            for(GcObj* object = objects; object != nullptr; object = object->next) {
+                if(object->refCount == 0 || object->gcRefs > 0) {
+                    object->reachable = true;
+                    worklist.push_back(object);
+                }
+            }
+            while(!worklist.empty()) {
+                GcObj* object = worklist.back();
+                worklist.pop_back();
+                object->trace([&worklist](GcObj* child) {
+                    if(!child->reachable) {
+                        child->reachable = true;
+                        worklist.push_back(child);
+                    }
+                });
+            }
+
+            std::vector<GcObj*> garbage;
+            for(GcObj* object = objects; object != nullptr; object = object->next) {
+                if(!object->reachable) garbage.push_back(object);
+            }
+
+            // Hold every dead object while the cycles are cut, then let the
+            // reference counts free them.
+            for(GcObj* object : garbage) object->refCount++;
+            for(GcObj* object : garbage) object->clear();
+            for(GcObj* object : garbage) {
+                if(--object->refCount == 0) delete object;
+            }
+
+            threshold = std::max(target,count);
+            return garbage.size();
+        }
+};
+
+inline GcObj::GcObj(TypeTag type) : Obj(type) {
+    Heap::instance().link(this);
+}
+
+inline GcObj::GcObj(const GcObj& other) : Obj(other) {
+    Heap::instance().link(this);
+}
+
+inline GcObj::~GcObj() {
+    Heap::instance().unlink(this);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+
+class Function;
+class Shape;
+
+// Per-site cache of property lookups (obj.name, obj.name = v, super.name).
+// Each entry is keyed by what decides the lookup's outcome: the receiver's
+// shape and class for obj.name, the shape alone for an assignment, the
+// class alone for super.name. The first key seen makes the site
+// monomorphic; up to SIZE keys are kept side by side, and beyond that new
+// keys replace the newest entry.
+//
+// Method and shape pointers are not owning: an entry can only hit while an
+// instance (or subclass) of its class is alive, and that keeps the class's
+// methods alive with it; shapes are never freed. Ids are never reused.
+class InlineCache {
+    public:
+        static constexpr size_t SIZE = 4;
+
+        // Totals across every site, for tuning (printed by --ic-stats).
+        static inline uint64_t hits = 0;
+        static inline uint64_t misses = 0;
+
+        class Entry {
+            public:
+                uint64_t key = 0;
+                // Field slot read or written, or -1.
+                int32_t slot = -1;
+                // Method found when the receiver has no such field.
+                Function* method = nullptr;
+                // Shape an assignment that adds the field transitions to.
+                Shape* transition = nullptr;
+        };
+
+        std::array<Entry,SIZE> entries;
+        uint8_t count = 0;
+
+        static uint64_t key(uint32_t shapeId,uint32_t classId) {
+            return (uint64_t(shapeId) << 32) | classId;
+        }
+
+        const Entry* find(uint64_t key) {
+            for(size_t i = 0; i < count; i++) {
+                if(entries[i].key == key) {
+                    hits++;
+                    return &entries[i];
+                }
+            }
+            misses++;
+            return nullptr;
+        }
+
+        void add(const Entry& entry) {
+            size_t index = count < SIZE ? count++ : SIZE - 1;
+            entries[index] = entry;
+        }
+
+        static void printStats(std::ostream& out) {
+            uint64_t total = hits + misses;
+            out << "inline caches: " << hits << " hits, " << misses << " misses";
+            if(total > 0) out << " (" << (hits * 100 / total) << "% hit rate)";
+            out << "\n";
+        }
+};
@@ -0,0 +1,367 @@
+#pragma once
+
+#include "optimizerPass.hpp"
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Copies an inlinable body expression, checking that it is one. Copies made
+// for a call site move parameters (depth 0 in the callee) to the call's
+// temporaries, and 'this' (depth 1 in a method) to the caller's 'this'.
+class InlineCopy : public ExprVisitor {
+    private:
+        Expression result;
+        const std::string& self;
+        int paramBase;
+        int thisDepth;
+
+        Expression copy(const Expression& expr) {
+            expr->accept(*this);
+            size++;
+            return std::move(result);
+        }
+
+        RuntimeValue unsupported() {
+            supported = false;
+            result = makeExpr<LiteralExpr>(_NIL);
+            return _NIL;
+        }
+
+    public:
+        bool supported = true;
+        bool readsThis = false;
+        int size = 0;
+
+        // A paramBase or thisDepth of -1 keeps those nodes as they are.
+        InlineCopy(const std::string& self,int paramBase = -1,int thisDepth = -1) :
+            self(self), paramBase(paramBase), thisDepth(thisDepth) {}
+
+        Expression run(const Expression& expr) {
+            return copy(expr);
+        }
+
+        RuntimeValue visitBinaryExpr(BinaryExpr& expr) override {
+            Expression left = copy(expr.left);
+            Expression right = copy(expr.right);
+            result = makeExpr<BinaryExpr>(std::move(left),expr.Operator,std::move(right));
+            return _NIL;
+        }
+
+        RuntimeValue visitLogicalExpr(LogicalExpr& expr) override {
+            Expression left = copy(expr.left);
+            Expression right = copy(expr.right);
+            result = makeExpr<LogicalExpr>(std::move(left),expr.Operator,std::move(right));
+            return _NIL;
+        }
+
+        RuntimeValue visitUnaryExpr(UnaryExpr& expr) override {
+            if(expr.Operator.type != TokenType::MINUS && expr.Operator.type != TokenType::BANG) return unsupported();
+            result = makeExpr<UnaryExpr>(expr.Operator,copy(expr.right));
+            return _NIL;
+        }
+
+        RuntimeValue visitGroupingExpr(GroupingExpr& expr) override {
+            result = makeExpr<GroupingExpr>(copy(expr.expression));
+            return _NIL;
+        }
+
+        RuntimeValue visitLiteralExpr(LiteralExpr& expr) override {
+            result = makeExpr<LiteralExpr>(expr.literal);
+            return _NIL;
+        }
+
+        // Parameters and globals only: the body has no locals of its own,
+        // and a closure's captured variables are not reachable from a
+        // call site.
+        RuntimeValue visitVariableExpr(VariableExpr& expr) override {
+            if(expr.depth > 0 || (expr.depth < 0 && expr.name.lexeme == self)) return unsupported();
+            auto variable = makeExpr<VariableExpr>(expr.name);
+            variable->depth = expr.depth;
+            variable->slot = expr.slot;
+            if(expr.depth == 0 && paramBase >= 0) variable->slot = paramBase + expr.slot;
+            result = std::move(variable);
+            return _NIL;
+        }
+
+        RuntimeValue visitThisExpr(ThisExpr& expr) override {
+            if(expr.depth != 1) return unsupported();
+            readsThis = true;
+            auto copy = makeExpr<ThisExpr>(expr.keyword);
+            copy->depth = thisDepth >= 0 ? thisDepth : expr.depth;
+            copy->slot = expr.slot;
+            result = std::move(copy);
+            return _NIL;
+        }
+
+        RuntimeValue visitGetExpr(GetExpr& expr) override {
+            if(dynamic_cast<ThisExpr*>(expr.object.get()) && expr.name.lexeme == self) return unsupported();
+            result = makeExpr<GetExpr>(copy(expr.object),expr.name);
+            return _NIL;
+        }
+
+        RuntimeValue visitCallExpr(CallExpr& expr) override {
+            Expression callee = copy(expr.callee);
+            std::vector<Expression> arguments;
+            for(auto& argument : expr.arguments) {
+                arguments.push_back(copy(argument));
+            }
+            result = makeExpr<CallExpr>(expr.name,std::move(callee),expr.paren,std::move(arguments));
+            return _NIL;
+        }
+
+        RuntimeValue visitAssignExpr(AssignExpr&) override { return unsupported(); }
+        RuntimeValue visitSetExpr(SetExpr&) override { return unsupported(); }
+        RuntimeValue visitSuperExpr(SuperExpr&) override { return unsupported(); }
+        RuntimeValue visitInlineExpr(InlineExpr&) override { return unsupported(); }
+        RuntimeValue visitInvariantExpr(InvariantExpr&) override { return unsupported(); }
+};
+
+// Finds what the Inliner must not assume: globals that are assigned, and
+// which classes declare which methods and extend which others.
+class InlineAnalysis : public OptimizerPass {
+    public:
+        std::unordered_map<std::string,int> globalDeclarations;
+        std::unordered_set<std::string> assignedGlobals;
+        std::unordered_set<std::string> fieldNames;
+        std::unordered_map<std::string,int> classDeclarations;
+        std::unordered_set<std::string> globalClasses;
+        // Subclass name -> superclass name, for superclasses named by a
+        // global variable.
+        std::unordered_map<std::string,std::string> superclasses;
+        // Some class extends an expression that is not a global variable.
+        bool opaqueSuperclass = false;
+        std::unordered_map<std::string,std::unordered_set<std::string>> methodNames;
+
+        using OptimizerPass::OptimizerPass;
+
+        void run(std::vector<Statement>& program) override {
+            for(auto& stmt : program) {
+                if(auto var = dynamic_cast<VarStmt*>(stmt.get())) globalDeclarations[var->name.lexeme]++;
+                if(auto function = dynamic_cast<FunctionStmt*>(stmt.get())) globalDeclarations[function->name.lexeme]++;
+                if(auto klass = dynamic_cast<ClassStmt*>(stmt.get())) {
+                    globalDeclarations[klass->name.lexeme]++;
+                    globalClasses.insert(klass->name.lexeme);
+                }
+            }
+            OptimizerPass::run(program);
+        }
+
+        RuntimeValue visitAssignExpr(AssignExpr& expr) override {
+            if(expr.depth < 0) assignedGlobals.insert(expr.name.lexeme);
+            return OptimizerPass::visitAssignExpr(expr);
+        }
+
+        RuntimeValue visitSetExpr(SetExpr& expr) override {
+            fieldNames.insert(expr.name.lexeme);
+            return OptimizerPass::visitSetExpr(expr);
+        }
+
+        RuntimeValue visitClassStmt(ClassStmt& stmt) override {
+            classDeclarations[stmt.name.lexeme]++;
+            if(stmt.superclass != nullptr) {
+                auto superclass = dynamic_cast<VariableExpr*>(stmt.superclass.get());
+                if(superclass != nullptr && superclass->depth < 0) superclasses[stmt.name.lexeme] = superclass->name.lexeme;
+                else opaqueSuperclass = true;
+            }
+            for(auto& method : stmt.methods) {
+                methodNames[stmt.name.lexeme].insert(method.name.lexeme);
+            }
+            return OptimizerPass::visitClassStmt(stmt);
+        }
+
+        // A global that can only hold the class of that name: a top-level
+        // class declared once, with no other global or class of its name,
+        // and never assigned.
+        bool namesClass(const std::string& name) const {
+            auto declarations = globalDeclarations.find(name);
+            auto classes = classDeclarations.find(name);
+            return globalClasses.contains(name) && declarations->second == 1 && classes->second == 1 &&
+                   !assignedGlobals.contains(name);
+        }
+
+        // No class below klass declares the method. Subclasses are found by
+        // the names their superclass expressions use, so this holds only if
+        // every superclass expression names a class (see namesClass);
+        // otherwise a class may extend klass through an alias.
+        bool final(const std::string& klass,const std::string& method) const {
+            if(opaqueSuperclass) return false;
+            for(auto& [subclass,superclass] : superclasses) {
+                if(!namesClass(superclass)) return false;
+            }
+            for(auto& [subclass,superclass] : superclasses) {
+                std::string ancestor = superclass;
+                std::unordered_set<std::string> seen;
+                while(ancestor != klass && seen.insert(ancestor).second) {
+                    auto next = superclasses.find(ancestor);
+                    if(next == superclasses.end()) break;
+                    ancestor = next->second;
+                }
+                if(ancestor != klass) continue;
+                auto methods = methodNames.find(subclass);
+                if(methods != methodNames.end() && methods->second.contains(method)) return false;
+            }
+            return true;
+        }
+};
+
+// Replaces calls to small, non-recursive functions with their bodies (-O2).
+//
+// A callee qualifies if its body is a single 'return <expression>' that
+// only reads its parameters, globals and 'this', of at most BUDGET nodes.
+// Two kinds of call sites are inlined:
+//
+//  - f(...) where f is a global function that is declared once and never
+//    assigned, and the call comes in a top-level statement after f's
+//    declaration, so f is known to be defined when it runs;
+//  - this.m(...) inside a method of class C, where C declares m (not
+//    'init'), no subclass of C overrides it and no field anywhere is
+//    named m, so the lookup can only find C's m.
+//
+// The call becomes an InlineExpr: arguments are stored in temporaries
+// added to the innermost frame, checked against the declared parameter
+// types, and the result goes through the declared return type's
+// promotion, so errors and warnings match the call. Calls in top-level
+// code outside any block have no frame to hold temporaries and are left
+// alone, as are calls made inside an inlined body. GROWTH caps the nodes
+// copied into the program.
+class Inliner : public OptimizerPass {
+    private:
+        static constexpr int BUDGET = 24;
+        static constexpr int GROWTH = 4096;
+
+        class Candidate {
+            public:
+                FunctionStmt* function;
+                Expression body;
+                int size;
+        };
+
+        InlineAnalysis analysis;
+        std::unordered_map<std::string,Candidate> functions;
+        std::unordered_set<std::string> defined;
+        // Methods by class name.
+        std::unordered_map<std::string,std::unordered_map<std::string,Candidate>> methods;
+        std::vector<ClassStmt*> classes;
+        // The 'slots' of each frame the traversal is inside, innermost last.
+        std::vector<int*> frames;
+        int growth = 0;
+
+        static bool candidate(FunctionStmt& function,Candidate& result) {
+            if(function.body.size() != 1) return false;
+            auto ret = dynamic_cast<ReturnStmt*>(function.body[0].get());
+            if(ret == nullptr || ret->value == nullptr) return false;
+
+            InlineCopy copy(function.name.lexeme);
+            Expression body = copy.run(ret->value);
+            if(!copy.supported || copy.size > BUDGET) return false;
+            result = Candidate{&function,std::move(body),copy.size};
+            return true;
+        }
+
+        const Candidate* calleeOf(CallExpr& expr,int& thisDepth) {
+            if(auto variable = dynamic_cast<VariableExpr*>(expr.callee.get())) {
+                if(variable->depth >= 0 || !defined.contains(variable->name.lexeme)) return nullptr;
+                auto found = functions.find(variable->name.lexeme);
+                return found == functions.end() ? nullptr : &found->second;
+            }
+
+            auto get = dynamic_cast<GetExpr*>(expr.callee.get());
+            auto self = get != nullptr ? dynamic_cast<ThisExpr*>(get->object.get()) : nullptr;
+            if(self == nullptr || classes.empty()) return nullptr;
+            auto klass = methods.find(classes.back()->name.lexeme);
+            if(klass == methods.end()) return nullptr;
+            auto found = klass->second.find(get->name.lexeme);
+            if(found == klass->second.end()) return nullptr;
+            thisDepth = self->depth;
+            return &found->second;
+        }
+
+        void collect(std::vector<Statement>& program) {
+            for(auto& stmt : program) {
+                if(auto function = dynamic_cast<FunctionStmt*>(stmt.get())) {
+                    const std::string& name = function->name.lexeme;
+                    Candidate found;
+                    if(analysis.globalDeclarations[name] == 1 && !analysis.assignedGlobals.contains(name) && candidate(*function,found)) {
+                        functions.emplace(name,std::move(found));
+                    }
+                }
+            }
+        }
+
+        void collectMethods(ClassStmt& stmt) {
+            const std::string& klass = stmt.name.lexeme;
+            if(analysis.classDeclarations[klass] != 1) return;
+            std::unordered_map<std::string,int> declared;
+            for(auto& method : stmt.methods) declared[method.name.lexeme]++;
+            for(auto& method : stmt.methods) {
+                const std::string& name = method.name.lexeme;
+                if(name == "init" || declared[name] != 1 || analysis.fieldNames.contains(name) || !analysis.final(klass,name)) continue;
+                Candidate found;
+                if(candidate(method,found)) methods[klass].emplace(name,std::move(found));
+            }
+        }
+
+    public:
+        Inliner(Interpreter& interpreter) : OptimizerPass(interpreter), analysis(interpreter) {}
+
+        void run(std::vector<Statement>& program) override {
+            analysis.run(program);
+            collect(program);
+            for(auto& stmt : program) {
+                rewrite(stmt);
+                if(auto function = dynamic_cast<FunctionStmt*>(stmt.get())) defined.insert(function->name.lexeme);
+            }
+            std::erase(program,nullptr);
+        }
+
+        RuntimeValue visitBlockStmt(BlockStmt& stmt) override {
+            frames.push_back(&stmt.slots);
+            OptimizerPass::visitBlockStmt(stmt);
+            frames.pop_back();
+            return _NIL;
+        }
+
+        RuntimeValue visitFunctionStmt(FunctionStmt& stmt) override {
+            frames.push_back(&stmt.slots);
+            OptimizerPass::visitFunctionStmt(stmt);
+            frames.pop_back();
+            return _NIL;
+        }
+
+        RuntimeValue visitClassStmt(ClassStmt& stmt) override {
+            collectMethods(stmt);
+            classes.push_back(&stmt);
+            OptimizerPass::visitClassStmt(stmt);
+            classes.pop_back();
+            return _NIL;
+        }
+
+        RuntimeValue visitCallExpr(CallExpr& expr) override {
+            OptimizerPass::visitCallExpr(expr);
+            if(frames.empty()) return _NIL;
+
+            int thisDepth = -1;
+            const Candidate* callee = calleeOf(expr,thisDepth);
+            if(callee == nullptr || growth + callee->size > GROWTH) return _NIL;
+            FunctionStmt& function = *callee->function;
+            if(function.params.size() != expr.arguments.size()) return _NIL;
+
+            std::vector<TypeTag> types;
+            for(auto& param : function.params) {
+                types.push_back(typeTagOf(static_cast<VarStmt&>(*param).type.lexeme));
+            }
+
+            int& slots = *frames.back();
+            int base = slots;
+            slots += function.params.size();
+            growth += callee->size;
+
+            Expression body = InlineCopy(function.name.lexeme,base,thisDepth).run(callee->body);
+            auto& ret = static_cast<ReturnStmt&>(*function.body[0]);
+            auto inlined = makeExpr<InlineExpr>(expr.name,std::move(expr.arguments),std::move(types),std::move(body),ret.keyword,function.returnType);
+            inlined->slot = base;
+            replace(std::move(inlined));
+            return _NIL;
+        }
+};
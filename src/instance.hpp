@@ -3,44 +3,81 @@
 #include "class.hpp"
 #include "error.hpp"
 #include "function.hpp"
+#include "shape.hpp"
 #include "util.hpp"
 #include <memory>
-#include <unordered_map>
+#include <vector>
 
-class Inst : public std::enable_shared_from_this<Inst>{
+class Inst : public GcObj {
     private:
-        Class klass;
-        std::unordered_map<std::string, LiteralValue> fields;
+        Ref<Class> klass;
+        Shape* shape = Shape::root();
+        // Indexed by the shape's slots.
+        std::vector<RuntimeValue> fields;
 
     public:
-        Inst(Class klass) : klass(klass) {}
+        Inst(Ref<Class> klass) : GcObj(TypeTag::INSTANCE), klass(std::move(klass)) {}
 
         std::string toString() const {
-            return "<" + klass.name + " instance>";
+            return "<" + klass->name + " instance>";
         }
 
-        RuntimeValue get(Token name) {
-            if(fields.contains(name.lexeme)) {
-                return fields[name.lexeme];
+        void trace(const Tracer& tracer) const override {
+            tracer(klass.get());
+            for(auto& value : fields) traceValue(value,tracer);
+        }
+
+        void clear() override {
+            klass = nullptr;
+            shape = Shape::root();
+            fields.clear();
+        }
+
+        // What obj.name refers to: a field slot or, failing that, a method.
+        InlineCache::Entry lookup(const Token& name,InlineCache& cache) {
+            uint64_t key = InlineCache::key(shape->id,klass->id);
+            if(const InlineCache::Entry* entry = cache.find(key)) return *entry;
+
+            InlineCache::Entry found{key,shape->find(name.lexeme)};
+            if(found.slot < 0) {
+                found.method = klass->findMethod(name.lexeme).get();
+                if(found.method == nullptr)
+                    throw RuntimeError(name,"Undefined property '" + name.lexeme + "'.");
             }
+            cache.add(found);
+            return found;
+        }
 
-            std::shared_ptr<Function> method = klass.findMethod(name.lexeme);
-            if(method != nullptr) return method->bind(shared_from_this());
+        const RuntimeValue& field(int slot) const {
+            return fields[slot];
+        }
 
-            throw RuntimeError(name,"Undefined property '" + name.lexeme + "'.");
+        RuntimeValue get(const Token& name,InlineCache& cache) {
+            InlineCache::Entry entry = lookup(name,cache);
+            if(entry.slot >= 0) return fields[entry.slot];
+            return entry.method->bind(Instance(this));
         }
 
-        void set(Token name,LiteralValue value) {
-            fields[name.lexeme] = value;
+        void set(const Token& name,RuntimeValue value,InlineCache& cache) {
+            uint64_t key = InlineCache::key(shape->id,0);
+            const InlineCache::Entry* entry = cache.find(key);
+            InlineCache::Entry found;
+            if(entry == nullptr) {
+                found = {key,shape->find(name.lexeme)};
+                if(found.slot < 0) found.transition = shape->withField(name.lexeme);
+                cache.add(found);
+                entry = &found;
+            }
+
+            if(entry->slot >= 0) {
+                fields[entry->slot] = std::move(value);
+            } else {
+                shape = entry->transition;
+                fields.push_back(std::move(value));
+            }
         }
 };
 
-RuntimeValue Class::call(Interpreter& interpreter, const Token& name,const std::vector<Expression>& exprs) {
-    Instance instance = makeShared<Inst>(*this);
-    std::shared_ptr<Function> initializer = findMethod("init");
-    if(initializer != nullptr) {
-        initializer->bind(instance)->call(interpreter,name,exprs);
-    }
-
-    return instance;
+Instance Value::asInstance() const {
+    return Instance(static_cast<Inst*>(obj()));
 }
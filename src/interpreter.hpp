@@ -1,5 +1,6 @@
 #pragma once
 
+#include "binaryOps.hpp"
 #include "instance.hpp"
 #include "function.hpp"
 #include "token.hpp"
@@ -17,79 +18,27 @@
 #include "callable.hpp"
 #include "warning.hpp"
 
-#define BIN_OP(actualType, op, retType, retTypeStr) \
-    { \
-        retType val = std::get<actualType>(leftval) op std::get<actualType>(rightval); \
-        return LiteralValue{LiteralCore{val}, retTypeStr}; \
-    }
-
-#define TYPE_BIN_OP(type, actualType, op, retType, retTypeStr) \
-    if(targetType == type) BIN_OP(actualType, op, retType, retTypeStr); \
-
 class Interpreter : public ExprVisitor, public StmtVisitor{
     private:
 
-        bool isTruthy(LiteralValue literal) const {
-            if(literal.second == "nil") return false;
-            if(literal.second == "boolean") return std::get<bool>(literal.first);
-            return true;
-        }
-
-        LiteralValue isEqual(const LiteralCore& l,const LiteralCore& r) const {
-            if(isNil(l) && isNil(r)) return {true,"bool"};
-            if(isNil(l)) return {false,"bool"};
-
-            return {true,"boolean"};
-        }
-
         bool isLiteral(Expr* expr) {
             return dynamic_cast<LiteralExpr*>(expr) != nullptr;
         }
 
-        int getPriority(std::string type){
-            if(type == "boolean") return 0;
-            if(type == "integer") return 1;
-            if(type == "decimal") return 2;
-            if(type == "BigDecimal") return 3;
-            if(type == "string") return 4;
-            return -1;
-        }
-
-        std::string stringify(RuntimeValue result) const {
-
-            if(std::holds_alternative<CallAble>(result)) {
-                CallAble callee = std::get<CallAble>(result);
-                return callee->toString();
-            }
-
-            if(std::holds_alternative<Instance>(result)) {
-                Instance inst = std::get<Instance>(result);
-                return inst->toString();
-            }
-
-            LiteralValue lit = getLiteralValue(result);
-            if (lit.second == "boolean") {
-                return std::get<bool>(lit.first) ? "true" : "false";
-            } else if (lit.second == "integer") {
-                return (std::get<Integer>(lit.first)).toString();
-            } else if (lit.second == "decimal") {
-                return cleanDouble(std::get<double>(lit.first));
-            } else if(lit.second == "BigDecimal") {
-                return (std::get<BigDecimal>(lit.first)).toString();
-            } else if (lit.second == "string") {
-                return "'" + std::get<std::string>(lit.first) + "'";
-            } else if(lit.second == "type") {
-                return "<" + std::get<std::string>(lit.first) + ">";
+        // A negative depth is the Resolver's mark for a global.
+        RuntimeValue lookUpVariable(const Token& name,int depth,int slot) {
+            if(depth >= 0) {
+                return environment->getAt(depth,slot);
             } else {
-                return "nil";
+                return globals->get(name);
             }
         }
 
-        RuntimeValue lookUpVariable(Token name,Expr* expr) {
-            if(locals.contains(expr)) {
-                return environment->getAt(locals[expr],name.lexeme);
+        void assignVariable(const Token& name,int depth,int slot,RuntimeValue value) {
+            if(depth >= 0) {
+                environment->assignAt(depth,slot,std::move(value));
             } else {
-                return globals->get(name);
+                globals->assign(name,std::move(value));
             }
         }
 
@@ -102,229 +51,67 @@ class Interpreter : public ExprVisitor, public StmtVisitor{
         }
 
         RuntimeValue visitUnaryExpr(UnaryExpr& expr) override {
-            LiteralValue value = getLiteralValue(evaluate(expr.right));
+            RuntimeValue value = evaluate(expr.right);
 
             switch(expr.Operator.type){
-                case TokenType::MINUS : 
-                    if(value.second == "integer")
-                        return  LiteralValue{- std::get<Integer>(value.first),"integer"};
-                    if(value.second == "decimal")
-                        return LiteralValue{- std::get<double>(value.first),"decimal"};
-                    if(value.second == "BigDecimal")
-                        return LiteralValue{- std::get<BigDecimal>(value.first),"BigDecimal"};
-                    throw RuntimeError(expr.Operator,"Unsupported operand");
-
-                case TokenType::BANG :
-                    return LiteralValue{!isTruthy(value),"boolean"};
-
                 case TokenType::PRE_INCR :
-                case TokenType::POST_INCR : 
-                    {
-                        LiteralValue original = value;
-                        LiteralValue incrementedValue;
-
-                        if(value.second == "integer")
-                            incrementedValue = {++std::get<Integer>(value.first),"integer"};
-                        else if(value.second == "decimal")
-                            incrementedValue = {std::get<double>(value.first)+1,"decimal"};
-                        else if(value.second == "BigDecimal")
-                            incrementedValue = {++std::get<BigDecimal>(value.first),"decimal"};
-                        else
-                            throw RuntimeError(expr.Operator, "Invalid operand type for '++'");
-
-                        if(auto varExpr = dynamic_cast<VariableExpr*>(expr.right.get())) {
-                            environment->assign(varExpr->name,incrementedValue);
-
-                            return (expr.Operator.type == TokenType::PRE_INCR)
-                                ? incrementedValue
-                                : original;
-                        } else if(isLiteral(expr.right.get())) {
-                            throw RuntimeError(expr.Operator,"Cannot apply '++' to a literal.");
-                        } else {
-                            throw RuntimeError(expr.Operator,"Cannot apply '++' to non-assignable expression.");
-                        }
-                    }
-                    break;
-
+                case TokenType::POST_INCR :
                 case TokenType::PRE_DECR :
                 case TokenType::POST_DECR :
                     {
-                        LiteralValue original = value;
-                        LiteralValue decrementedValue;
-
-                        if(value.second == "integer")
-                            decrementedValue = {--std::get<Integer>(value.first),"integer"};
-                        else if(value.second == "decimal")
-                            decrementedValue = {std::get<double>(value.first)-1,"decimal"};
-                        else if(value.second == "BigDecimal")
-                            decrementedValue = {--std::get<BigDecimal>(value.first),"BigDecimal"};
-                        else
-                            throw RuntimeError(expr.Operator, "Invalid operand type for '--'");
-
-                        if(auto varExpr = dynamic_cast<VariableExpr*>(expr.right.get())) {
-                            environment->assign(varExpr->name,decrementedValue);
-
-                            return (expr.Operator.type == TokenType::PRE_DECR)
-                                ? decrementedValue
-                                : original;
-                        } else if(isLiteral(expr.right.get())) {
-                            throw RuntimeError(expr.Operator,"Cannot apply '--' to a literal");
-                        } else {
-                            throw RuntimeError(expr.Operator,"Cannot apply '--' to non-assignable expression.");
-                        }
+                        auto varExpr = dynamic_cast<VariableExpr*>(expr.right.get());
+                        return stepVariable(expr.Operator,value,varExpr,isLiteral(expr.right.get()));
                     }
-                    break;
 
+                default:
+                    return unaryOp(expr.Operator,value);
             }
-
-            return _NIL;
         }
 
         RuntimeValue visitVariableExpr(VariableExpr& expr) override {
-            return lookUpVariable(expr.name,&expr);
+            return lookUpVariable(expr.name,expr.depth,expr.slot);
         }
 
         RuntimeValue visitBinaryExpr(BinaryExpr& expr) override {
-           LiteralValue left = getLiteralValue(evaluate(expr.left));
-           LiteralValue right = getLiteralValue(evaluate(expr.right));
-
-           std::string targetType = getPriority(left.second) > getPriority(right.second) ? left.second : right.second;
-           auto [leftval,leftType] = promoteType(left,targetType,expr.Operator,"Operands are of incompatible types!");
-           auto [rightval,rightType] = promoteType(right,targetType,expr.Operator,"Operands are of incompatible types!");
-           switch(expr.Operator.type){
-               
-               case TokenType::GREATER:
-                    TYPE_BIN_OP("integer",Integer,>,bool,"boolean");
-                    TYPE_BIN_OP("decimal",double,>,bool,"boolean");
-                    TYPE_BIN_OP("BigDecimal",BigDecimal,>,bool,"boolean")
-                    TYPE_BIN_OP("string",std::string,>,bool,"boolean");
-                    TYPE_BIN_OP("boolean",bool,>,bool,"boolean");
-                    break;
-                case TokenType::GREATER_EQUAL:
-                    TYPE_BIN_OP("integer",Integer,>=,bool,"boolean");
-                    TYPE_BIN_OP("decimal",double,>=,bool,"boolean");
-                    TYPE_BIN_OP("BigDecimal",BigDecimal,>=,bool,"boolean")
-                    TYPE_BIN_OP("string",std::string,>=,bool,"boolean");
-                    TYPE_BIN_OP("boolean",bool,>=,bool,"boolean");
-                    break;
-                case TokenType::LESS:
-                    TYPE_BIN_OP("integer",Integer,<,bool,"boolean");
-                    TYPE_BIN_OP("decimal",double,<,bool,"boolean");
-                    TYPE_BIN_OP("BigDecimal",BigDecimal,<,bool,"boolean")
-                    TYPE_BIN_OP("string",std::string,<,bool,"boolean");
-                    TYPE_BIN_OP("boolean",bool,<,bool,"boolean");
-                    break;
-                case TokenType::LESS_EQUAL:
-                    TYPE_BIN_OP("integer",Integer,<=,bool,"boolean");
-                    TYPE_BIN_OP("decimal",double,<=,bool,"boolean");
-                    TYPE_BIN_OP("BigDecimal",BigDecimal,<=,bool,"boolean")
-                    TYPE_BIN_OP("string",std::string,<=,bool,"boolean");
-                    TYPE_BIN_OP("boolean",bool,<=,bool,"boolean");
-                    break;
-               case TokenType::BANG_EQUAL:
-                    TYPE_BIN_OP("integer",Integer,!=,bool,"boolean");
-                    TYPE_BIN_OP("decimal",double,!=,bool,"boolean");
-                    TYPE_BIN_OP("BigDecimal",BigDecimal,!=,bool,"boolean")
-                    TYPE_BIN_OP("string",std::string,!=,bool,"boolean");
-                    TYPE_BIN_OP("boolean",bool,!=,bool,"boolean");
-                    break;
-               case TokenType::EQUAL_EQUAL:
-                    TYPE_BIN_OP("integer",Integer,==,bool,"boolean");
-                    TYPE_BIN_OP("decimal",double,==,bool,"boolean");
-                    TYPE_BIN_OP("BigDecimal",BigDecimal,==,bool,"boolean")
-                    TYPE_BIN_OP("string",std::string,==,bool,"boolean");
-                    TYPE_BIN_OP("boolean",bool,==,bool,"boolean");
-                    break;
-               case TokenType::PLUS:
-                    TYPE_BIN_OP("integer",Integer,+,Integer,"integer");
-                    TYPE_BIN_OP("decimal",double,+,double,"decimal");
-                    TYPE_BIN_OP("BigDecimal",BigDecimal,+,BigDecimal,"BigDecimal")
-                    {
-                        if(targetType == "boolean"){
-                            std::cout<<ImplicitConversionWarning(expr.Operator,"integer","boolean").message();
-                            BIN_OP(bool,+,Integer,"integer");
-                        }
-                    }
-                    TYPE_BIN_OP("string",std::string,+,std::string,"string");
-                    break;
-               case TokenType::MINUS:
-                    TYPE_BIN_OP("integer",Integer,-,Integer,"integer");
-                    TYPE_BIN_OP("decimal",double,-,double,"decimal");
-                    TYPE_BIN_OP("BigDecimal",BigDecimal,-,BigDecimal,"BigDecimal")
-                    {
-                        if(targetType == "boolean"){
-                            std::cout<<ImplicitConversionWarning(expr.Operator,"integer","boolean").message();
-                            BIN_OP(bool,-,Integer,"integer");
-                        }
-                    }
-                    if(targetType == "string") throw RuntimeError(expr.Operator,"Unsupported operand type for 'string' and 'string'.");
-                    break;
-               case TokenType::STAR:
-                    TYPE_BIN_OP("integer",Integer,*,Integer,"integer");
-                    TYPE_BIN_OP("decimal",double,*,double,"decimal");
-                    TYPE_BIN_OP("BigDecimal",BigDecimal,*,BigDecimal,"BigDecimal")
-                    {
-                        if(targetType == "boolean"){
-                            std::cout<<ImplicitConversionWarning(expr.Operator,"integer","boolean").message();
-                            BIN_OP(bool,*,Integer,"integer");
-                        }
-                    }
-                    if(targetType == "string") throw RuntimeError(expr.Operator,"Unsupported operand type for 'string' and 'string'.");
-                    break;
-               case TokenType::SLASH:
-                    if(targetType == "integer"){
-                        if(std::get<Integer>(rightval) != 0) BIN_OP(Integer,/,Integer,"integer");
-                        throw RuntimeError(expr.Operator,"Divide by zero error");
-                    }
-                    if(targetType == "decimal"){
-                        if(std::get<double>(rightval) != 0.0) BIN_OP(double,/,double,"decimal");
-                        throw RuntimeError(expr.Operator,"Divide by zero error");
-                    }
-                    if(targetType == "BigDecimal"){
-                        if(std::get<BigDecimal>(rightval) != 0) BIN_OP(BigDecimal,/,BigDecimal,"BigDecimal");
-                        throw RuntimeError(expr.Operator,"Divide by zero error");
-                    }
-                    if(targetType == "boolean"){
-                        if(std::get<bool>(rightval) != false) BIN_OP(Integer,/,Integer,"integer");
-                        std::cout<<ImplicitConversionWarning(expr.Operator,"boolean","integer").message();
-                        throw RuntimeError(expr.Operator,"Divide by zero error ('false' evaluates to '0')");
-                    }
-                    if(targetType == "string") throw RuntimeError(expr.Operator,"Unsupported operand type for 'string' and 'string'.");
-                    break;
-               case TokenType::PERCENT:
-                    if(targetType == "integer"){
-                        if(std::get<Integer>(rightval) != 0) BIN_OP(Integer,%,Integer,"integer");
-                        throw RuntimeError(expr.Operator,"Modulo by zero error");
-                    }
-                    if(targetType == "decimal"){
-                        if(std::get<double>(rightval) != 0.0) 
-                            return LiteralValue{fmod(std::get<double>(leftval),std::get<double>(rightval)),"decimal"};
-                        throw RuntimeError(expr.Operator,"Modulo by zero error");
-                    }
-                    if(targetType == "BigDecimal"){
-                        if(std::get<BigDecimal>(rightval) != 0) BIN_OP(BigDecimal,%,BigDecimal,"BigDecimal");
-                        throw RuntimeError(expr.Operator,"Modulo by zero error");
-                    }
-                    if(targetType == "boolean"){
-                        if(std::get<bool>(rightval) != false) BIN_OP(Integer,%,Integer,"integer");
-                        std::cout<<ImplicitConversionWarning(expr.Operator,"integer","boolean").message();
-                        throw RuntimeError(expr.Operator,"Modulo by zero error ('false' evaluates to '0')");
-                    }
-                    if(targetType == "string") throw RuntimeError(expr.Operator,"Unsupported operand type for 'string' and 'string'.");
-                    break;
-          }
-
-           return _NIL;
+           RuntimeValue left = evaluate(expr.left);
+           RuntimeValue right = evaluate(expr.right);
+           return binaryOp(expr.Operator,left,right);
         }
 
         RuntimeValue visitCallExpr(CallExpr& expr) override {
+            if(auto get = dynamic_cast<GetExpr*>(expr.callee.get())) {
+                return invokeMethod(*get,expr);
+            }
             RuntimeValue callee = evaluate(expr.callee);
-            if (auto function = std::get_if<CallAble>(&callee)) {
-                int arity = (*function)->arity();
-                if(arity != expr.arguments.size()) {
-                    throw RuntimeError(expr.paren,"Expected "+std::to_string(arity)+" arguments but got "+std::to_string(expr.arguments.size())+".");
-                }
-                return (*function)->call(*this,expr.name,std::move(expr.arguments));
+            return callValue(callee,expr);
+        }
+
+        // obj.name(...) runs the method with obj as its receiver instead of
+        // binding it first; a field holding a callable is called as usual.
+        RuntimeValue invokeMethod(GetExpr& get,CallExpr& expr) {
+            RuntimeValue object = evaluate(get.object);
+            if(!object.isInstance()) {
+                throw RuntimeError(get.name,"Only instances have properties.");
+            }
+
+            InlineCache::Entry entry = object.asInstance()->lookup(get.name,get.cache);
+            if(entry.slot >= 0) {
+                return callValue(object.asInstance()->field(entry.slot),expr);
+            }
+
+            checkArity(*entry.method,expr);
+            std::vector<RuntimeValue> args;
+            for(auto& argument : expr.arguments) {
+                args.push_back(evaluate(argument));
+            }
+            return entry.method->invoke(*this,expr.name,std::move(args),object);
+        }
+
+        RuntimeValue callValue(const RuntimeValue& callee,CallExpr& expr) {
+            if (callee.isCallable()) {
+                CallAble function = callee.asCallable();
+                checkArity(*function,expr);
+                return function->call(*this,expr.name,std::move(expr.arguments));
             } else {
                 throw RuntimeError(expr.paren,"Can only call functions and classes.");
             }
@@ -332,8 +119,42 @@ class Interpreter : public ExprVisitor, public StmtVisitor{
             return _NIL;
         }
 
+        // A call the Inliner replaced with the callee's body. The arguments
+        // go into temporaries of the current frame, with the checks and
+        // the return conversion a real call would make.
+        RuntimeValue visitInlineExpr(InlineExpr& expr) override {
+            for(size_t i = 0; i < expr.arguments.size(); i++) {
+                RuntimeValue value = evaluate(expr.arguments[i]);
+                TypeTag type = value.typeTag();
+                environment->defineAt(expr.slot + i,std::move(value),type);
+            }
+            checkInlineArguments(expr);
+            return inlineResult(expr,evaluate(expr.body));
+        }
+
+        // A loop-invariant expression: evaluated where it stands the first
+        // time, then read back from its temporary until the loop restarts.
+        // A value that printed a warning is not kept, so the warning still
+        // appears every time.
+        RuntimeValue visitInvariantExpr(InvariantExpr& expr) override {
+            if(environment->getTypeAt(expr.depth,expr.slot) == TypeTag::VARIABLE) {
+                return environment->getAt(expr.depth,expr.slot);
+            }
+            uint64_t warnings = Warning::issued;
+            RuntimeValue value = evaluate(expr.expression);
+            if(Warning::issued == warnings) storeInvariant(expr.depth,expr.slot,value);
+            return value;
+        }
+
+        void checkArity(Callable& function,const CallExpr& expr) {
+            int arity = function.arity();
+            if(arity != static_cast<int>(expr.arguments.size())) {
+                throw RuntimeError(expr.paren,"Expected "+std::to_string(arity)+" arguments but got "+std::to_string(expr.arguments.size())+".");
+            }
+        }
+
         RuntimeValue visitLogicalExpr(LogicalExpr& expr) override {
-            LiteralValue left = getLiteralValue(evaluate(expr.left));
+            RuntimeValue left = evaluate(expr.left);
 
             switch (expr.Operator.type) {
                 case TokenType::OR:
@@ -345,12 +166,12 @@ class Interpreter : public ExprVisitor, public StmtVisitor{
                     return evaluate(expr.right);
 
                 case TokenType::PIPE_PIPE:
-                    if (isTruthy(left)) return LiteralValue{ true, "boolean" };
-                    return LiteralValue{ isTruthy(getLiteralValue(evaluate(expr.right))), "boolean" };
+                    if (isTruthy(left)) return RuntimeValue(true);
+                    return RuntimeValue(isTruthy(evaluate(expr.right)));
 
                 case TokenType::AMP_AMP:
-                    if (!isTruthy(left)) return LiteralValue{ false, "boolean" };
-                    return LiteralValue{ isTruthy(getLiteralValue(evaluate(expr.right))), "boolean" };
+                    if (!isTruthy(left)) return RuntimeValue(false);
+                    return RuntimeValue(isTruthy(evaluate(expr.right)));
 
                 default:
                     throw RuntimeError(expr.Operator,"Invalid logical operator.");
@@ -359,21 +180,15 @@ class Interpreter : public ExprVisitor, public StmtVisitor{
 
         RuntimeValue visitAssignExpr(AssignExpr& expr) override {
             RuntimeValue value = evaluate(expr.value);
-            
-            if(locals.contains(&expr)) {
-                environment->assignAt(locals[&expr],expr.name,value);
-            } else {
-                globals->assign(expr.name,value);
-            }
-
+            assignVariable(expr.name,expr.depth,expr.slot,value);
             return value;
         }
 
         RuntimeValue visitGetExpr(GetExpr& expr) override {
             RuntimeValue object = evaluate(expr.object);
 
-            if(std::holds_alternative<Instance>(object)) {
-                return std::get<Instance>(object)->get(expr.name);
+            if(object.isInstance()) {
+                return object.asInstance()->get(expr.name,expr.cache);
             }
 
             throw RuntimeError(expr.name,"Only instances have properties.");
@@ -381,11 +196,9 @@ class Interpreter : public ExprVisitor, public StmtVisitor{
 
         RuntimeValue visitSetExpr(SetExpr& expr) override {
             RuntimeValue object = evaluate(expr.object);
-            auto ptr = std::get<std::shared_ptr<Inst>>(object);
-
-            if(std::holds_alternative<Instance>(object)) {
-                LiteralValue value = getLiteralValue(evaluate(expr.value));
-                std::get<Instance>(object)->set(expr.name,value);
+            if(object.isInstance()) {
+                RuntimeValue value = evaluate(expr.value);
+                object.asInstance()->set(expr.name,value,expr.cache);
                 return value;
             }
 
@@ -393,22 +206,11 @@ class Interpreter : public ExprVisitor, public StmtVisitor{
         }
 
         RuntimeValue visitSuperExpr(SuperExpr& expr) override {
-            int distance = locals[&expr];
-            auto callable = std::get<CallAble>(environment->getAt(distance, "super"));
-            auto ptr = dynamic_cast<Class*>(callable.get());
-            if (!ptr) throw RuntimeError(expr.method, "super is not a class.");
-            auto superclass = std::dynamic_pointer_cast<Class>(callable);
-
-            Instance object = std::get<Instance>(environment->getAt(distance-1,"this"));
-            std::shared_ptr<Function> method = superclass->findMethod(expr.method.lexeme);
-            if(method == nullptr) {
-                throw RuntimeError(expr.method,"Undefined property '" + expr.method.lexeme + "'.");
-            }
-            return method->bind(object);
+            return lookUpSuper(expr.method,expr.depth,expr.cache);
         }
 
         RuntimeValue visitThisExpr(ThisExpr& expr) override {
-             return lookUpVariable(expr.keyword,&expr);
+             return lookUpVariable(expr.keyword,expr.depth,expr.slot);
         }
 
         RuntimeValue visitPrintStmt(PrintStmt& stmt) override {
@@ -427,14 +229,14 @@ class Interpreter : public ExprVisitor, public StmtVisitor{
             if(stmt.initializer != nullptr){
                 value = evaluate(stmt.initializer);
             }
-            environment->define(stmt.name.lexeme,value,stmt.type.lexeme);
+            defineVariable(stmt.slot,stmt.name,value,typeTagOf(stmt.type.lexeme));
             return _NIL;
         }
 
         RuntimeValue visitIfStmt(IfStmt& stmt) override {
-            if(isTruthy(getLiteralValue(evaluate(stmt.ifCondition)))){
+            if(isTruthy(evaluate(stmt.ifCondition))){
                 execute(stmt.thenBranch);
-            } else if(stmt.elifCondition != nullptr && isTruthy(getLiteralValue(evaluate(stmt.elifCondition)))){
+            } else if(stmt.elifCondition != nullptr && isTruthy(evaluate(stmt.elifCondition))){
                 execute(stmt.elifBranch);
             } else if(stmt.elseBranch != nullptr){
                 execute(stmt.elseBranch);
@@ -443,8 +245,10 @@ class Interpreter : public ExprVisitor, public StmtVisitor{
         }
 
         RuntimeValue visitWhileStmt(WhileStmt& stmt) override {
-            while(isTruthy(getLiteralValue(evaluate(stmt.condition)))){
+            clearInvariants(stmt.invariantSlot,stmt.invariants);
+            while(isTruthy(evaluate(stmt.condition))){
                 execute(stmt.body);
+                if(returning) break;
             }
 
             return _NIL;
@@ -454,13 +258,19 @@ class Interpreter : public ExprVisitor, public StmtVisitor{
             if (stmt.initializer != nullptr) {
                 execute(stmt.initializer);
             }
+            clearInvariants(stmt.invariantSlot,stmt.invariants);
+            if(stmt.step != 0) {
+                runCountedLoop(stmt);
+                return _NIL;
+            }
 
             while (true) {
-                if (stmt.condition != nullptr && !isTruthy(getLiteralValue(evaluate(stmt.condition)))) {
+                if (stmt.condition != nullptr && !isTruthy(evaluate(stmt.condition))) {
                     break;
                 }
 
                 execute(stmt.body);
+                if (returning) break;
 
                 if (stmt.increment != nullptr) {
                     evaluate(stmt.increment);
@@ -470,79 +280,106 @@ class Interpreter : public ExprVisitor, public StmtVisitor{
             return _NIL;
         }
 
+        // A loop CountedLoops marked: the counter is tested and stepped in
+        // place rather than through the condition's left side and the
+        // increment.
+        void runCountedLoop(ForStmt& stmt) {
+            auto& condition = static_cast<BinaryExpr&>(*stmt.condition);
+            int slot = static_cast<VarStmt&>(*stmt.initializer).slot;
+            Environment* frame = environment.get();
+
+            while (true) {
+                RuntimeValue limit = evaluate(condition.right);
+                if (!countedTest(condition.Operator,frame->getAt(0,slot),limit)) break;
+
+                execute(stmt.body);
+                if (returning) break;
+
+                if (!countedStep(*frame,slot,stmt.step)) evaluate(stmt.increment);
+            }
+        }
+
         RuntimeValue visitFunctionStmt(FunctionStmt& stmt) override {
-            Function function(stmt, environment,false);
-            environment->define(stmt.name.lexeme,makeShared<Function>(function),stmt.kind);
+            defineVariable(stmt.slot,stmt.name,makeRef<Function>(stmt,environment,false),TypeTag::FUNCTION);
             return _NIL;
         }
 
         RuntimeValue visitReturnStmt(ReturnStmt& stmt) override {
-            RuntimeValue value = nullptr;
-            if(stmt.value != nullptr) value = evaluate(stmt.value);
-            throw Return(stmt.keyword,value,stmt.retType);
+            RuntimeValue value = _NIL;
+            if(stmt.tailCall) {
+                // Hand a Dharma function back to Function::call with its
+                // arguments instead of calling it from this native frame.
+                auto& call = static_cast<CallExpr&>(*stmt.value);
+                RuntimeValue callee;
+                RuntimeValue receiver;
+                Ref<Function> function;
+                if(auto get = dynamic_cast<GetExpr*>(call.callee.get())) {
+                    receiver = evaluate(get->object);
+                    if(!receiver.isInstance()) {
+                        throw RuntimeError(get->name,"Only instances have properties.");
+                    }
+                    InlineCache::Entry entry = receiver.asInstance()->lookup(get->name,get->cache);
+                    if(entry.slot >= 0) {
+                        callee = receiver.asInstance()->field(entry.slot);
+                        receiver = _NIL;
+                    } else {
+                        function = Ref<Function>(entry.method);
+                    }
+                } else {
+                    callee = evaluate(call.callee);
+                }
+                if(function == nullptr && callee.isCallable()) function = refCast<Function>(callee.asCallable());
+                if(function != nullptr) {
+                    checkArity(*function,call);
+                    std::vector<RuntimeValue> args;
+                    for(auto& argument : call.arguments) {
+                        args.push_back(evaluate(argument));
+                    }
+                    returning.emplace(stmt.keyword,std::move(function),std::move(args),std::move(receiver),call.name);
+                    return _NIL;
+                }
+                value = callValue(callee,call);
+            } else if(stmt.value != nullptr) {
+                value = evaluate(stmt.value);
+            }
+            returning.emplace(stmt.keyword,std::move(value));
+            return _NIL;
         }
 
         RuntimeValue visitClassStmt(ClassStmt& stmt) override {
             RuntimeValue superclass = _NIL;
-            std::shared_ptr<Class> supClass = nullptr;
-
             if(stmt.superclass != nullptr){
                 superclass = evaluate(stmt.superclass);
-                auto varExpr = dynamic_cast<VariableExpr*>(stmt.superclass.get());
-                if(!std::holds_alternative<CallAble>(superclass)) {
-                    throw RuntimeError(varExpr->name,"Superclass must be a class");
-                }
-
-                if(!dynamic_cast<Class*>(std::get<CallAble>(superclass).get())) {
-                    throw RuntimeError(varExpr->name,"Superclass must be a class");
-                }
-
-            }
-
-            if(std::get_if<CallAble>(&superclass) != nullptr){
-                supClass = makeShared<Class>(*dynamic_cast<Class*>(std::get<CallAble>(superclass).get()));
-            }
-
-            environment->define(stmt.name.lexeme, _NIL, "class");
-            if(stmt.superclass != nullptr) {
-                environment = new Environment(environment);
-                environment->define("super",superclass,"superclass");
-            }
-
-            std::unordered_map<std::string,std::shared_ptr<Function>> methods;
-            for(auto& method : stmt.methods) {
-                Function function(method,environment,method.name.lexeme == "init");
-                methods[method.name.lexeme] = makeShared<Function>(function);
-            }
-
-            Class klass(stmt.name.lexeme,supClass,methods);
-
-            if(stmt.superclass != nullptr){
-                environment = environment->enclosing;
             }
 
-            environment->assign(stmt.name,makeShared<Class>(klass));
+            defineClass(stmt,superclass);
             return _NIL;
         }
 
         RuntimeValue visitBlockStmt(BlockStmt& stmt) override {
-            Environment* newEnvironment = new Environment(environment);
+            Environment* newEnvironment = newFrame(environment,stmt.slots,stmt.escapes);
             executeBlock(stmt.statements, newEnvironment);
             return _NIL;
         }
 
     public:
 
-        Environment* globals = new Environment();
-        Environment* environment = new Environment();
-        std::unordered_map<Expr*, int> locals;
+        Ref<Environment> globals = makeRef<Environment>();
+        Ref<Environment> environment;
+        FrameArena arena;
+        std::optional<Return> returning;
 
         Interpreter() : environment(globals) {
-            globals->define("clock",makeShared<ClockFunction>(),"function");
-            globals->define("typeOf",makeShared<TypeOfFunction>(),"function");
+            globals->define("clock",makeRef<ClockFunction>(),TypeTag::FUNCTION);
+            globals->define("typeOf",makeRef<TypeOfFunction>(),TypeTag::FUNCTION);
         }
 
-        ~Interpreter() {}
+        // Globals and the functions they hold refer to each other; cut that
+        // cycle, then collect whatever the program left behind.
+        ~Interpreter() {
+            globals->clear();
+            Heap::instance().collect();
+        }
 
         void interpret(std::vector<Statement>& stmts){
             try{
@@ -554,39 +391,233 @@ class Interpreter : public ExprVisitor, public StmtVisitor{
             }
         }
 
-        void resolve(Expr* expr, int depth) {
-            locals[expr] = depth;
+        // A negative slot is the Resolver's mark for a global declaration.
+        void defineVariable(int slot,const Token& name,RuntimeValue value,TypeTag type) {
+            if(slot < 0) environment->define(name.lexeme,std::move(value),type);
+            else environment->defineAt(slot,std::move(value),type);
+        }
+
+        bool isTruthy(const RuntimeValue& value) const {
+            if(value.isNil()) return false;
+            if(value.isBool()) return value.asBool();
+            return true;
+        }
+
+        std::string stringify(const RuntimeValue& result) const {
+
+            switch(result.typeTag()) {
+                case TypeTag::FUNCTION:
+                case TypeTag::CLASS:
+                    return result.asCallable()->toString();
+                case TypeTag::INSTANCE:
+                    return result.asInstance()->toString();
+                case TypeTag::BOOLEAN:
+                    return result.asBool() ? "true" : "false";
+                case TypeTag::INTEGER:
+                    return result.asInteger().toString();
+                case TypeTag::DECIMAL:
+                    return cleanDouble(result.asDecimal());
+                case TypeTag::BIG_DECIMAL:
+                    return result.asBigDecimal().toString();
+                case TypeTag::STRING:
+                    return "'" + result.asString() + "'";
+                case TypeTag::TYPE:
+                    return "<" + result.asString() + ">";
+                default:
+                    return "nil";
+            }
+        }
+
+        RuntimeValue unaryOp(const Token& Operator,const RuntimeValue& value) {
+            switch(Operator.type){
+                case TokenType::MINUS : 
+                    if(value.isInteger())
+                        return RuntimeValue(- value.asInteger());
+                    if(value.isDecimal())
+                        return RuntimeValue(- value.asDecimal());
+                    if(value.isBigDecimal())
+                        return RuntimeValue(- value.asBigDecimal());
+                    throw RuntimeError(Operator,"Unsupported operand");
+
+                case TokenType::BANG :
+                    return RuntimeValue(!isTruthy(value));
+            }
+
+            return _NIL;
+        }
+
+        // The value '++'/'--' stores back into its operand.
+        RuntimeValue stepValue(const Token& Operator,const RuntimeValue& value) {
+            bool increment = Operator.type == TokenType::PRE_INCR || Operator.type == TokenType::POST_INCR;
+
+            if(value.isInteger())
+                return increment ? value.asInteger() + Integer(1) : value.asInteger() - Integer(1);
+            if(value.isDecimal())
+                return increment ? value.asDecimal() + 1 : value.asDecimal() - 1;
+            if(value.isBigDecimal())
+                return increment ? value.asBigDecimal() + BigDecimal(1) : value.asBigDecimal() - BigDecimal(1);
+
+            throw RuntimeError(Operator, increment ? "Invalid operand type for '++'" : "Invalid operand type for '--'");
+        }
+
+        [[noreturn]] void stepTargetError(const Token& Operator,bool literal) {
+            bool increment = Operator.type == TokenType::PRE_INCR || Operator.type == TokenType::POST_INCR;
+            if(literal)
+                throw RuntimeError(Operator,increment ? "Cannot apply '++' to a literal." : "Cannot apply '--' to a literal");
+            throw RuntimeError(Operator,increment ? "Cannot apply '++' to non-assignable expression." : "Cannot apply '--' to non-assignable expression.");
+        }
+
+        RuntimeValue stepVariable(const Token& Operator,const RuntimeValue& value,VariableExpr* variable,bool literal) {
+            RuntimeValue stepped = stepValue(Operator,value);
+            if(variable == nullptr) stepTargetError(Operator,literal);
+
+            assignVariable(variable->name,variable->depth,variable->slot,stepped);
+            bool prefix = Operator.type == TokenType::PRE_INCR || Operator.type == TokenType::PRE_DECR;
+            return prefix ? stepped : value;
+        }
+
+        RuntimeValue binaryOp(const Token& Operator,const RuntimeValue& left,const RuntimeValue& right) {
+            return binaryOperation(Operator,left,right);
+        }
+
+        // A counted loop's condition, on machine words while the counter
+        // and the limit are small integers.
+        bool countedTest(const Token& Operator,const RuntimeValue& counter,const RuntimeValue& limit) {
+            if(!counter.isSmallInt() || !limit.isSmallInt()) return isTruthy(binaryOp(Operator,counter,limit));
+
+            int i = counter.asSmallInt();
+            int n = limit.asSmallInt();
+            switch(Operator.type) {
+                case TokenType::LESS:          return i < n;
+                case TokenType::LESS_EQUAL:    return i <= n;
+                case TokenType::GREATER:       return i > n;
+                case TokenType::GREATER_EQUAL: return i >= n;
+                default:                       return i != n;
+            }
+        }
+
+        // Steps a counted loop's counter in place if it is a small integer.
+        // Otherwise returns false and the increment must run instead.
+        bool countedStep(Environment& frame,int slot,int step) {
+            const RuntimeValue& counter = frame.getAt(0,slot);
+            if(!counter.isSmallInt()) return false;
+            frame.assignAt(0,slot,Integer(static_cast<int64_t>(counter.asSmallInt()) + step));
+            return true;
+        }
+
+        // Function::bindArguments' type check.
+        void checkInlineArguments(const InlineExpr& expr) {
+            for(size_t i = 0; i < expr.types.size(); i++) {
+                TypeTag type = expr.types[i];
+                if(type != TypeTag::VARIABLE && type != environment->getTypeAt(0,expr.slot + i))
+                    throw RuntimeError(expr.name,"No matching function call.");
+            }
+        }
+
+        // Function::returnValue's conversion.
+        RuntimeValue inlineResult(const InlineExpr& expr,RuntimeValue value) {
+            TypeTag type = typeTagOf(expr.returnType.lexeme);
+            if(type == TypeTag::VARIABLE || type == value.typeTag()) return value;
+            std::string errMsg = "Cannot convert '" + typeName(value.typeTag()) + "' to '" + expr.returnType.lexeme + "'.";
+            return promoteType(value,type,expr.keyword,errMsg);
+        }
+
+        // Forgets the values a loop's invariant expressions cached the last
+        // time it ran.
+        void clearInvariants(int slot,int count) {
+            for(int i = 0; i < count; i++) {
+                environment->defineAt(slot + i,_NIL,TypeTag::NIL);
+            }
+        }
+
+        void storeInvariant(int depth,int slot,const RuntimeValue& value) {
+            environment->ancestor(depth)->defineAt(slot,value,TypeTag::VARIABLE);
+        }
+
+        RuntimeValue lookUpSuper(const Token& methodName,int distance,InlineCache& cache) {
+            RuntimeValue callable = environment->getAt(distance,0);
+            Ref<Class> superclass = callable.isCallable() ? refCast<Class>(callable.asCallable()) : nullptr;
+            if (superclass == nullptr) throw RuntimeError(methodName, "super is not a class.");
+
+            Instance object = environment->getAt(distance-1,0).asInstance();
+            Function* method = superclass->findMethod(methodName.lexeme,cache);
+            if(method == nullptr) {
+                throw RuntimeError(methodName,"Undefined property '" + methodName.lexeme + "'.");
+            }
+            return method->bind(object);
+        }
+
+        void defineClass(ClassStmt& stmt,const RuntimeValue& superclass,const std::vector<const Chunk*>& code = {}) {
+            Ref<Class> supClass = nullptr;
+
+            if(stmt.superclass != nullptr){
+                auto varExpr = dynamic_cast<VariableExpr*>(stmt.superclass.get());
+                if(!superclass.isCallable()) {
+                    throw RuntimeError(varExpr->name,"Superclass must be a class");
+                }
+
+                if(!dynamic_cast<Class*>(superclass.asCallable().get())) {
+                    throw RuntimeError(varExpr->name,"Superclass must be a class");
+                }
+
+            }
+
+            if(superclass.isCallable()){
+                supClass = refCast<Class>(superclass.asCallable());
+            }
+
+            defineVariable(stmt.slot,stmt.name,_NIL,TypeTag::CLASS);
+            if(stmt.superclass != nullptr) {
+                environment = new Environment(environment,1);
+                environment->defineAt(0,superclass,TypeTag::SUPERCLASS);
+            }
+
+            std::unordered_map<std::string,Ref<Function>> methods;
+            for(size_t i = 0;i<stmt.methods.size();i++) {
+                FunctionStmt& method = stmt.methods[i];
+                methods[method.name.lexeme] = makeRef<Function>(method,environment,method.name.lexeme == "init",code.empty() ? nullptr : code[i]);
+            }
+
+            Ref<Class> klass = makeRef<Class>(stmt.name.lexeme,supClass,methods);
+
+            if(stmt.superclass != nullptr){
+                environment = environment->enclosing;
+            }
+
+            if(stmt.slot < 0) environment->assign(stmt.name,klass);
+            else environment->assignAt(0,stmt.slot,klass);
         }
 
-        LiteralValue promoteType(const LiteralValue& operand,std::string targetType,const Token& token,std::string msg) {
-            const auto& [value,currentType] = operand;
+        RuntimeValue promoteType(const RuntimeValue& operand,TypeTag targetType,const Token& token,const std::string& msg) {
+            TypeTag currentType = operand.typeTag();
 
-            if(targetType == "int") targetType = "integer";
             if(currentType == targetType) return operand;
-            LiteralValue retValue = {Nil(),"nil"};
-            if(currentType == "nil"){
-                if(targetType == "integer") retValue = {Integer(0),targetType};
-                if(targetType == "decimal") retValue =  {static_cast<double>(0),targetType};
-                if(targetType == "BigDecimal") retValue = {BigDecimal(0),targetType};
-                if(targetType == "boolean") retValue = {false,"boolean"};
-            } else if(currentType == "boolean"){
-                bool val = std::get<bool>(value);
-                if(targetType == "integer") retValue = {Integer(val),"integer"};
-                if(targetType == "decimal") retValue = {static_cast<double>(val),"decimal"};
-                if(targetType == "BigDecimal") retValue = {BigDecimal(val),"BigDecimal"};
-            } else if(currentType == "integer"){
-                Integer val = std::get<Integer>(value);
-                if(targetType == "decimal") retValue = {val.toDecimal(),"decimal"};
-                if(targetType == "BigDecimal") retValue = {val.toBigDecimal(),"BigDecimal"};
-            } else if(currentType == "decimal"){
-                double val = std::get<double>(value);
-                if(targetType == "BigDecimal") retValue = {BigDecimal(val),"BigDecimal"};
-            } 
-            if(retValue.second == "nil"){
+            if(!canPromote(currentType,targetType)){
                 throw RuntimeError(token,msg);
             }
+
+            RuntimeValue retValue;
+            switch(targetType) {
+                case TypeTag::BOOLEAN:
+                    retValue = false;
+                    break;
+                case TypeTag::INTEGER:
+                    retValue = Integer(operand.isBool() && operand.asBool());
+                    break;
+                case TypeTag::DECIMAL:
+                    if(operand.isInteger()) retValue = operand.asInteger().toDecimal();
+                    else retValue = static_cast<double>(operand.isBool() && operand.asBool());
+                    break;
+                case TypeTag::BIG_DECIMAL:
+                    if(operand.isInteger()) retValue = operand.asInteger().toBigDecimal();
+                    else if(operand.isDecimal()) retValue = BigDecimal(operand.asDecimal());
+                    else retValue = BigDecimal(operand.isBool() && operand.asBool());
+                    break;
+                default:
+                    break;
+            }
             
-            std::cout<<ImplicitConversionWarning(token,targetType,currentType).message();
+            std::cout<<ImplicitConversionWarning(token,typeName(targetType),typeName(currentType)).message();
             return retValue;
         }
 
@@ -596,65 +627,158 @@ class Interpreter : public ExprVisitor, public StmtVisitor{
         }
 
         void execute(const Statement& stmt){
+            Heap::instance().collectIfNeeded();
             stmt->accept(*this);
         }
 
+        // Scopes that a closure may capture go on the heap; the rest come from
+        // the arena and are released when their block or call finishes.
+        Environment* newFrame(const Ref<Environment>& enclosing,int slots,bool escapes) {
+            if(escapes) return new Environment(enclosing,slots);
+            return arena.acquire(enclosing,slots);
+        }
+
         void executeBlock(std::vector<Statement>& stmts,Environment* newEnvironment){
             EnvSwitch Switch(this->environment,newEnvironment);
+            FrameRelease release(arena,newEnvironment);
 
             for(auto& stmt : stmts){
                 execute(stmt);
+                if(returning) break;
             }
         }
 
 };
 
-RuntimeValue Function::call(Interpreter& interpreter, const Token& name,const std::vector<Expression>& exprs) {
-    Environment* environment = new Environment(closure);
-    std::vector<LiteralValue> args;
+RuntimeValue Callable::call(Interpreter& interpreter, const Token& name,const std::vector<Expression>& exprs) {
+    std::vector<RuntimeValue> args;
     for(auto& expr: exprs){
-        args.push_back(getLiteralValue(interpreter.evaluate(expr)));
+        args.push_back(interpreter.evaluate(expr));
     }
 
+    return callValues(interpreter,name,std::move(args));
+}
+
+RuntimeValue Function::callValues(Interpreter& interpreter, const Token& name,std::vector<RuntimeValue> args) {
+    return invoke(interpreter,name,std::move(args));
+}
+
+RuntimeValue Function::invoke(Interpreter& interpreter,const Token& name,std::vector<RuntimeValue> args,const RuntimeValue& instance) {
+    Ref<Function> function(this);
+    RuntimeValue receiver = instance;
+    const Token* callName = &name;
+    // Return type conversions still owed by functions that tail called
+    // into a callee whose result they may need to promote.
+    class Conversion {
+        public:
+            Ref<Function> function;
+            const Token* keyword;
+            RuntimeValue receiver;
+    };
+    std::vector<Conversion> conversions;
+    RuntimeValue result;
+
+    while(true) {
+        Environment* environment = function->bindArguments(interpreter,*callName,args,receiver);
+        // Released after the body's frame, which executeBlock releases.
+        FrameRelease releaseThis(interpreter.arena,receiver.isNil() ? nullptr : environment->enclosing.get());
+        interpreter.executeBlock(function->declaration.body,environment);
+        if(!interpreter.returning) {
+            result = function->implicitReturn(receiver);
+            break;
+        }
+
+        Return completion = std::move(*interpreter.returning);
+        interpreter.returning.reset();
+        if(completion.callee == nullptr) {
+            result = function->returnValue(interpreter,*completion.keyword,completion.value,receiver);
+            break;
+        }
+
+        Ref<Function>& callee = completion.callee;
+        if(function->returnType != TypeTag::VARIABLE && (function->returnType != callee->returnType || callee->isInitializer)) {
+            conversions.push_back({function,completion.keyword,receiver});
+        }
+        function = std::move(callee);
+        args = std::move(completion.arguments);
+        receiver = std::move(completion.receiver);
+        callName = completion.callName;
+    }
+
+    for(auto it = conversions.rbegin(); it != conversions.rend(); it++) {
+        result = it->function->returnValue(interpreter,*it->keyword,result,it->receiver);
+    }
+    return result;
+}
+
+Environment* Function::bindArguments(Interpreter& interpreter,const Token& name,const std::vector<RuntimeValue>& args,const RuntimeValue& receiver) {
     for(int i = 0;i<declaration.params.size();i++){
         auto varExpr = dynamic_cast<VarStmt*>(declaration.params[i].get());
-        std::string varType = varExpr->type.lexeme == "int" ? "integer" : varExpr->type.lexeme;
-        if(varType != args[i].second && varType != "var")
+        TypeTag varType = typeTagOf(varExpr->type.lexeme);
+        if(varType != args[i].typeTag() && varType != TypeTag::VARIABLE)
             throw RuntimeError(name,"No matching function call.");
-        environment->define(varExpr->name.lexeme,args[i],args[i].second);
     }
 
-    try {
-        interpreter.executeBlock(declaration.body,environment);
-    } catch (Return& returnValue) {
-        if(isInitializer) return closure->getAt(0,"this");
-        LiteralValue retVal = getLiteralValue(returnValue.value);
-        std::string retType = returnValue.retType->lexeme;
-        if(retType == "var") retType = retVal.second;
-        std::string errMsg = "Cannot convert '" + retVal.second + "' to '" + retType + "'.";
-        LiteralValue val = interpreter.promoteType(retVal,retType,returnValue.keyword,errMsg);
-        return val;
+    Ref<Environment> enclosing = closure;
+    if(!receiver.isNil()) {
+        // The frame bind() would have allocated on the heap. Only closures
+        // declared in the body can capture it.
+        enclosing = interpreter.newFrame(closure,1,declaration.escapes);
+        enclosing->defineAt(0,receiver,TypeTag::CLASS);
     }
 
-    if(isInitializer) return closure->getAt(0,"this");
-    return LiteralValue{Nil(),"nil"};
+    Environment* environment = interpreter.newFrame(enclosing,declaration.slots,declaration.escapes);
+    for(size_t i = 0;i<declaration.params.size();i++){
+        auto varExpr = dynamic_cast<VarStmt*>(declaration.params[i].get());
+        environment->defineAt(varExpr->slot,args[i],args[i].typeTag());
+    }
+
+    return environment;
+}
+
+RuntimeValue Function::returnValue(Interpreter& interpreter,const Token& keyword,const RuntimeValue& value,const RuntimeValue& receiver) {
+    if(isInitializer) return self(receiver);
+    if(returnType == TypeTag::VARIABLE || returnType == value.typeTag()) return value;
+    std::string errMsg = "Cannot convert '" + typeName(value.typeTag()) + "' to '" + declaration.returnType.lexeme + "'.";
+    return interpreter.promoteType(value,returnType,keyword,errMsg);
+}
+
+RuntimeValue Class::callValues(Interpreter& interpreter, const Token& name,std::vector<RuntimeValue> args) {
+    Instance instance = makeRef<Inst>(Ref<Class>(this));
+    if(initializer != nullptr) {
+        initializer->invoke(interpreter,name,std::move(args),instance);
+    }
+
+    return instance;
+}
+
+RuntimeValue TypeOfFunction::describe(const RuntimeValue& arg,std::optional<TypeTag> declaredType) {
+    if(declaredType.has_value()) {
+        std::string type = typeName(declaredType.value());
+        if(declaredType == TypeTag::VARIABLE && !arg.isNil()) {
+            type += " " + typeName(arg.typeTag());
+        }
+        return RuntimeValue::ofType(type);
+    }
+    if(arg.isNil())
+        return RuntimeValue::ofType("WTF is wrong with you?");
+    return RuntimeValue::ofType(typeName(arg.typeTag()));
 }
 
 RuntimeValue TypeOfFunction::call(Interpreter& interpreter, const Token& name,const std::vector<Expression>& exprs) {
-    LiteralValue arg = getLiteralValue(interpreter.evaluate(exprs[0]));
+    RuntimeValue arg = interpreter.evaluate(exprs[0]);
     if(auto varExpr = dynamic_cast<VariableExpr*>(exprs[0].get())) {
-        std::string type;
-        if(interpreter.locals.contains(varExpr)) {
-            type = interpreter.environment->getTypeAt(interpreter.locals[varExpr], varExpr->name);
+        TypeTag type;
+        if(varExpr->depth >= 0) {
+            type = interpreter.environment->getTypeAt(varExpr->depth,varExpr->slot);
         } else {
             type = interpreter.globals->getType(varExpr->name);
         }
-        if(type == "variable" && arg.second != "nil") {
-            type += " " + arg.second;
-        }
-        return LiteralValue{type,"type"};
+        return describe(arg,type);
     }
-    if(arg.second == "nil")
-        return LiteralValue{std::string("WTF is wrong with you?"),"type"};
-    return LiteralValue{arg.second,"type"};
+    return describe(arg,std::nullopt);
+}
+
+RuntimeValue TypeOfFunction::callValues(Interpreter&, const Token&,std::vector<RuntimeValue> args) {
+    return describe(args[0],std::nullopt);
 }
@@ -0,0 +1,271 @@
+#pragma once
+
+#include "optimizerPass.hpp"
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// What a loop's condition, increment and body may change. Locals are
+// recorded by their distance from the frame the loop runs in, and only if
+// they are declared outside the loop.
+class LoopEffects : public OptimizerPass {
+    private:
+        // Scopes opened inside the loop around the node being scanned.
+        int nesting = 0;
+
+        void assign(const std::string& name,int depth,int slot) {
+            if(depth < 0) assignedGlobals.insert(name);
+            else if(depth >= nesting) assignedLocals.insert({depth - nesting,slot});
+        }
+
+    public:
+        std::set<std::pair<int,int>> assignedLocals;
+        std::unordered_set<std::string> assignedGlobals;
+        // A call can assign globals and any local a closure reaches, and a
+        // call or a property store can change any field.
+        bool calls = false;
+        bool stores = false;
+        // Functions and classes declared in the loop run later, in scopes
+        // this does not follow.
+        bool declares = false;
+
+        using OptimizerPass::OptimizerPass;
+
+        void scan(Expression& expr) {
+            rewrite(expr);
+        }
+
+        void scan(Statement& stmt) {
+            rewrite(stmt);
+        }
+
+        RuntimeValue visitBlockStmt(BlockStmt& stmt) override {
+            nesting++;
+            OptimizerPass::visitBlockStmt(stmt);
+            nesting--;
+            return _NIL;
+        }
+
+        RuntimeValue visitFunctionStmt(FunctionStmt&) override {
+            declares = true;
+            return _NIL;
+        }
+
+        RuntimeValue visitClassStmt(ClassStmt&) override {
+            declares = true;
+            return _NIL;
+        }
+
+        // Only a declaration in no block of its own lands in the loop's
+        // frame; the locals of the body's blocks live in frames of their own.
+        RuntimeValue visitVarStmt(VarStmt& stmt) override {
+            if(nesting == 0) assign(stmt.name.lexeme,stmt.slot < 0 ? -1 : 0,stmt.slot);
+            return OptimizerPass::visitVarStmt(stmt);
+        }
+
+        RuntimeValue visitAssignExpr(AssignExpr& expr) override {
+            assign(expr.name.lexeme,expr.depth,expr.slot);
+            return OptimizerPass::visitAssignExpr(expr);
+        }
+
+        RuntimeValue visitUnaryExpr(UnaryExpr& expr) override {
+            if(expr.Operator.type != TokenType::MINUS && expr.Operator.type != TokenType::BANG) {
+                if(auto variable = dynamic_cast<VariableExpr*>(expr.right.get())) {
+                    assign(variable->name.lexeme,variable->depth,variable->slot);
+                } else {
+                    stores = true;
+                }
+            }
+            return OptimizerPass::visitUnaryExpr(expr);
+        }
+
+        RuntimeValue visitCallExpr(CallExpr& expr) override {
+            calls = true;
+            return OptimizerPass::visitCallExpr(expr);
+        }
+
+        RuntimeValue visitSetExpr(SetExpr& expr) override {
+            stores = true;
+            return OptimizerPass::visitSetExpr(expr);
+        }
+
+        // The arguments are stored in temporaries of the innermost frame.
+        RuntimeValue visitInlineExpr(InlineExpr& expr) override {
+            for(size_t i = 0; i < expr.arguments.size(); i++) {
+                assign(expr.name.lexeme,0,expr.slot + i);
+            }
+            return OptimizerPass::visitInlineExpr(expr);
+        }
+};
+
+// Hoists loop-invariant expressions out of while and for loops (-O2).
+//
+// An expression is invariant in a loop if it is built with operators and
+// property reads from literals, 'this' and variables the loop never
+// assigns. If the loop makes a call, globals and locals a closure can
+// reach are not invariant; if it makes a call or stores a property, no
+// property read is.
+//
+// The expression stays where it is, wrapped in an InvariantExpr that keeps
+// its first value in a temporary of the frame the loop runs in; the loop
+// clears its temporaries before it starts. The expression then runs at
+// most once per run of the loop, and not at all if the loop never reaches
+// it, so its errors happen where they did before. Each expression is
+// hoisted out of the outermost loop it is invariant in. Loops in top-level
+// code outside any block have no frame for the temporaries and are left
+// alone, as are loops that declare functions or classes.
+class LoopInvariantCodeMotion : public OptimizerPass {
+    private:
+        class Scope {
+            public:
+                // Null for the scopes a class opens for 'super' and 'this'.
+                int* slots;
+                bool escapes;
+        };
+
+        class Loop {
+            public:
+                LoopEffects effects;
+                // Scopes open around the loop statement.
+                size_t scopes;
+                std::vector<InvariantExpr*> hoisted;
+        };
+
+        std::vector<Scope> scopes;
+        // The loops the traversal is inside, outermost first.
+        std::vector<Loop> loops;
+
+        // Scopes opened inside the loop around the node being rewritten.
+        int nesting(const Loop& loop) const {
+            return scopes.size() - loop.scopes;
+        }
+
+        bool invariant(const Loop& loop,const VariableExpr& variable) const {
+            const LoopEffects& effects = loop.effects;
+            if(variable.depth < 0) return !effects.calls && !effects.assignedGlobals.contains(variable.name.lexeme);
+
+            int distance = variable.depth - nesting(loop);
+            if(distance < 0 || effects.assignedLocals.contains({distance,variable.slot})) return false;
+            if(!effects.calls) return true;
+            int scope = static_cast<int>(loop.scopes) - 1 - distance;
+            return scope >= 0 && !scopes[scope].escapes;
+        }
+
+        bool invariant(const Loop& loop,const Expression& expr) const {
+            Expr* node = expr.get();
+            if(dynamic_cast<LiteralExpr*>(node) || dynamic_cast<ThisExpr*>(node)) return true;
+            if(auto variable = dynamic_cast<VariableExpr*>(node)) return invariant(loop,*variable);
+            if(auto grouping = dynamic_cast<GroupingExpr*>(node)) return invariant(loop,grouping->expression);
+            if(auto unary = dynamic_cast<UnaryExpr*>(node)) {
+                bool pure = unary->Operator.type == TokenType::MINUS || unary->Operator.type == TokenType::BANG;
+                return pure && invariant(loop,unary->right);
+            }
+            if(auto binary = dynamic_cast<BinaryExpr*>(node)) return invariant(loop,binary->left) && invariant(loop,binary->right);
+            if(auto logical = dynamic_cast<LogicalExpr*>(node)) return invariant(loop,logical->left) && invariant(loop,logical->right);
+            if(auto get = dynamic_cast<GetExpr*>(node)) {
+                return !loop.effects.calls && !loop.effects.stores && invariant(loop,get->object);
+            }
+            return false;
+        }
+
+        // Reading a literal or a variable costs no more than reading the
+        // temporary would.
+        static bool worthHoisting(const Expression& expr) {
+            Expr* node = expr.get();
+            if(auto grouping = dynamic_cast<GroupingExpr*>(node)) return worthHoisting(grouping->expression);
+            return !dynamic_cast<LiteralExpr*>(node) && !dynamic_cast<VariableExpr*>(node) && !dynamic_cast<ThisExpr*>(node);
+        }
+
+        bool enter(Expression& condition,Expression& increment,Statement& body) {
+            if(scopes.empty() || scopes.back().slots == nullptr) return false;
+            LoopEffects effects(interpreter);
+            effects.scan(condition);
+            effects.scan(increment);
+            effects.scan(body);
+            if(effects.declares) return false;
+            loops.push_back(Loop{std::move(effects),scopes.size(),{}});
+            return true;
+        }
+
+        // Gives the loop's hoisted expressions their temporaries.
+        void leave(int& invariantSlot,int& invariants) {
+            std::vector<InvariantExpr*> hoisted = std::move(loops.back().hoisted);
+            loops.pop_back();
+            if(hoisted.empty()) return;
+
+            int& slots = *scopes.back().slots;
+            invariantSlot = slots;
+            invariants = hoisted.size();
+            slots += invariants;
+            for(int i = 0; i < invariants; i++) {
+                hoisted[i]->slot = invariantSlot + i;
+            }
+        }
+
+    protected:
+        using OptimizerPass::rewrite;
+
+        void rewrite(Expression& expr) override {
+            if(expr != nullptr && worthHoisting(expr)) {
+                for(auto& loop : loops) {
+                    if(!invariant(loop,expr)) continue;
+                    auto hoisted = makeExpr<InvariantExpr>(std::move(expr));
+                    hoisted->depth = nesting(loop);
+                    loop.hoisted.push_back(hoisted.get());
+                    expr = std::move(hoisted);
+                    return;
+                }
+            }
+            OptimizerPass::rewrite(expr);
+        }
+
+    public:
+        using OptimizerPass::OptimizerPass;
+
+        RuntimeValue visitBlockStmt(BlockStmt& stmt) override {
+            scopes.push_back(Scope{&stmt.slots,stmt.escapes});
+            OptimizerPass::visitBlockStmt(stmt);
+            scopes.pop_back();
+            return _NIL;
+        }
+
+        RuntimeValue visitFunctionStmt(FunctionStmt& stmt) override {
+            scopes.push_back(Scope{&stmt.slots,stmt.escapes});
+            OptimizerPass::visitFunctionStmt(stmt);
+            scopes.pop_back();
+            return _NIL;
+        }
+
+        RuntimeValue visitClassStmt(ClassStmt& stmt) override {
+            rewrite(stmt.superclass);
+            size_t outer = scopes.size();
+            if(stmt.superclass != nullptr) scopes.push_back(Scope{nullptr,true});
+            scopes.push_back(Scope{nullptr,true});
+            for(auto& method : stmt.methods) {
+                visitFunctionStmt(method);
+            }
+            scopes.resize(outer);
+            return _NIL;
+        }
+
+        RuntimeValue visitWhileStmt(WhileStmt& stmt) override {
+            Expression none;
+            bool hoisting = enter(stmt.condition,none,stmt.body);
+            rewrite(stmt.condition);
+            rewriteBranch(stmt.body);
+            if(hoisting) leave(stmt.invariantSlot,stmt.invariants);
+            return _NIL;
+        }
+
+        RuntimeValue visitForStmt(ForStmt& stmt) override {
+            rewrite(stmt.initializer);
+            bool hoisting = enter(stmt.condition,stmt.increment,stmt.body);
+            rewrite(stmt.condition);
+            rewrite(stmt.increment);
+            rewriteBranch(stmt.body);
+            if(hoisting) leave(stmt.invariantSlot,stmt.invariants);
+            return _NIL;
+        }
+};
@@ -7,12 +7,24 @@
 #include <string>
 #include <filesystem>
 #include <vector>
+#include "optimizer.hpp"
 #include "resolver.hpp"
 #include "sourceManager.hpp"
 #include "parser.hpp"
 #include "stmt.hpp"
 #include "tokenizer.hpp"
 #include "interpreter.hpp"
+#include "compiler.hpp"
+#include "vm.hpp"
+
+enum class Engine {
+    TREE,
+    VM
+};
+
+Engine engine = Engine::TREE;
+bool icStats = false;
+int optLevel = Optimizer::DEFAULT_LEVEL;
 
 void run(const std::string& script){
     SourceManager::instance().setSource(script);
@@ -22,8 +34,16 @@ void run(const std::string& script){
     std::vector<Statement> statements = parser.parse();
     Interpreter interpreter;
     Resolver resolver(interpreter);
-    resolver.resolve(statements);
-    interpreter.interpret(statements);
+    if(!resolver.resolveProgram(statements)) return;
+    Optimizer(interpreter,optLevel).optimize(statements);
+    if(engine == Engine::VM) {
+        Compiler compiler(interpreter);
+        std::unique_ptr<Program> program = compiler.compile(statements);
+        VM vm(interpreter);
+        vm.interpret(*program);
+    } else {
+        interpreter.interpret(statements);
+    }
 }
 
 void runFile(const std::string& path){
@@ -47,22 +67,53 @@ void runPrompt(){
 }
 
 int main(int argc, char** argv){
-   if(argc > 2){
-        std::cerr<<"Usage karma [script]\n";
+   std::vector<std::string> args;
+   for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--engine=vm") {
+            engine = Engine::VM;
+        } else if(arg == "--engine=tree") {
+            engine = Engine::TREE;
+        } else if(arg.starts_with("--engine=")) {
+            std::cerr<<"Unknown engine '"<<arg.substr(9)<<"'. Expected 'tree' or 'vm'.\n";
+            exit(EXIT_FAILURE);
+        } else if(arg.size() == 3 && arg.starts_with("-O") && arg[2] >= '0' && arg[2] <= '0' + Optimizer::MAX_LEVEL) {
+            optLevel = arg[2] - '0';
+        } else if(arg.starts_with("-O")) {
+            std::cerr<<"Unknown optimization level '"<<arg<<"'. Expected -O0, -O1 or -O2.\n";
+            exit(EXIT_FAILURE);
+        } else if(arg == "--ic-stats") {
+            icStats = true;
+        } else if(arg.starts_with("--heap-target=")) {
+            char* end = nullptr;
+            unsigned long long target = std::strtoull(arg.c_str() + 14,&end,10);
+            if(end == arg.c_str() + 14 || *end != '\0' || target == 0) {
+                std::cerr<<"Invalid heap target '"<<arg.substr(14)<<"'. Expected a positive object count.\n";
+                exit(EXIT_FAILURE);
+            }
+            Heap::instance().setTarget(target);
+        } else {
+            args.push_back(arg);
+        }
+   }
+
+   if(args.size() > 1){
+        std::cerr<<"Usage karma [--engine=tree|vm] [-O0|-O1|-O2] [--heap-target=N] [--ic-stats] [script]\n";
         exit(EXIT_FAILURE);
-   } else if(argc == 2) {
-       std::filesystem::path filePath = argv[1];
+   } else if(args.size() == 1) {
+       std::filesystem::path filePath = args[0];
         if(filePath.extension() != ".dh"){
             std::cerr<<"Invalid file input to sutra!";
             exit(EXIT_FAILURE);
         }
-        if(!std::filesystem::exists(argv[1])){
-            std::cerr<<"File "<<argv[1]<<" does not exist!";
+        if(!std::filesystem::exists(args[0])){
+            std::cerr<<"File "<<args[0]<<" does not exist!";
             exit(EXIT_FAILURE);
         }
-        runFile(argv[1]);
+        runFile(args[0]);
    } else {
         runPrompt();
    }
+    if(icStats) InlineCache::printStats(std::cerr);
     return EXIT_SUCCESS;
 }
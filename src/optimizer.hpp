@@ -0,0 +1,49 @@
+#pragma once
+
+#include "countedLoops.hpp"
+#include "inliner.hpp"
+#include "loopInvariants.hpp"
+#include "optimizerPass.hpp"
+#include "scalarReplacement.hpp"
+#include "simplify.hpp"
+#include <memory>
+#include <vector>
+
+// Runs the AST passes for an optimization level between the Resolver and
+// execution (either engine).
+//
+//   -O0  nothing
+//   -O1  constant folding, branch pruning, dead code after 'return',
+//        counted loops
+//   -O2  everything in -O1, then scalar replacement of instances that do
+//        not escape, inlining (and folding what it exposes) and
+//        loop-invariant code motion
+class Optimizer {
+    private:
+        std::vector<std::unique_ptr<OptimizerPass>> passes;
+
+    public:
+        static constexpr int MAX_LEVEL = 2;
+        static constexpr int DEFAULT_LEVEL = 1;
+
+        Optimizer(Interpreter& interpreter,int level) {
+            if(level >= 1) {
+                passes.push_back(std::make_unique<ConstantFolding>(interpreter));
+                passes.push_back(std::make_unique<BranchPruning>(interpreter));
+                passes.push_back(std::make_unique<DeadCodeElimination>(interpreter));
+                passes.push_back(std::make_unique<CountedLoops>(interpreter));
+            }
+            if(level >= 2) {
+                passes.push_back(std::make_unique<ScalarReplacement>(interpreter));
+                passes.push_back(std::make_unique<Inliner>(interpreter));
+                passes.push_back(std::make_unique<ConstantFolding>(interpreter));
+                passes.push_back(std::make_unique<LoopInvariantCodeMotion>(interpreter));
+            }
+        }
+
+        void optimize(std::vector<Statement>& program) {
+            for(auto& pass : passes) {
+                pass->run(program);
+            }
+        }
+};
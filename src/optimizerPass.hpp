@@ -0,0 +1,213 @@
+#pragma once
+
+#include "expr.hpp"
+#include "interpreter.hpp"
+#include "stmt.hpp"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// A rewrite of the resolved AST. The default visit methods only walk into
+// every child; a pass overrides the ones it cares about.
+//
+// A visit replaces the node it is visiting by calling replace(): the new
+// node is swapped in once the visit returns. Replacing a statement with
+// null deletes it. Passes run after the Resolver, so a replacement must
+// keep the depths and slots it resolved valid: move resolved subtrees
+// around, but never into a different scope.
+class OptimizerPass : public ExprVisitor, public StmtVisitor {
+    private:
+        Expression exprReplacement;
+        Statement stmtReplacement;
+        bool stmtReplaced = false;
+
+    protected:
+        Interpreter& interpreter;
+
+        void replace(Expression expr) {
+            exprReplacement = std::move(expr);
+        }
+
+        void replace(Statement stmt) {
+            stmtReplacement = std::move(stmt);
+            stmtReplaced = true;
+        }
+
+        virtual void rewrite(Expression& expr) {
+            if(expr == nullptr) return;
+            expr->accept(*this);
+            if(exprReplacement != nullptr) expr = std::move(exprReplacement);
+        }
+
+        // A statement in a single-statement position (a branch or loop
+        // body) cannot be deleted; it becomes an empty block instead.
+        void rewrite(Statement& stmt) {
+            if(stmt == nullptr) return;
+            stmt->accept(*this);
+            if(!stmtReplaced) return;
+            stmtReplaced = false;
+            stmt = std::move(stmtReplacement);
+        }
+
+        void rewrite(std::vector<Statement>& stmts) {
+            for(auto& stmt : stmts) {
+                rewrite(stmt);
+            }
+            std::erase(stmts,nullptr);
+        }
+
+        void rewriteBranch(Statement& stmt) {
+            rewrite(stmt);
+            if(stmt == nullptr) stmt = makeStmt<BlockStmt>(std::vector<Statement>());
+        }
+
+        static LiteralExpr* literal(const Expression& expr) {
+            return dynamic_cast<LiteralExpr*>(expr.get());
+        }
+
+    public:
+        OptimizerPass(Interpreter& interpreter) : interpreter(interpreter) {}
+
+        virtual void run(std::vector<Statement>& program) {
+            rewrite(program);
+        }
+
+        RuntimeValue visitBlockStmt(BlockStmt& stmt) override {
+            rewrite(stmt.statements);
+            return _NIL;
+        }
+
+        RuntimeValue visitClassStmt(ClassStmt& stmt) override {
+            rewrite(stmt.superclass);
+            for(auto& method : stmt.methods) {
+                visitFunctionStmt(method);
+            }
+            return _NIL;
+        }
+
+        RuntimeValue visitExprStmt(ExprStmt& stmt) override {
+            rewrite(stmt.expression);
+            return _NIL;
+        }
+
+        RuntimeValue visitPrintStmt(PrintStmt& stmt) override {
+            rewrite(stmt.expression);
+            return _NIL;
+        }
+
+        RuntimeValue visitVarStmt(VarStmt& stmt) override {
+            rewrite(stmt.initializer);
+            return _NIL;
+        }
+
+        RuntimeValue visitFunctionStmt(FunctionStmt& stmt) override {
+            rewrite(stmt.body);
+            return _NIL;
+        }
+
+        RuntimeValue visitIfStmt(IfStmt& stmt) override {
+            rewrite(stmt.ifCondition);
+            rewriteBranch(stmt.thenBranch);
+            rewrite(stmt.elifCondition);
+            if(stmt.elifBranch != nullptr) rewriteBranch(stmt.elifBranch);
+            rewrite(stmt.elseBranch);
+            return _NIL;
+        }
+
+        RuntimeValue visitWhileStmt(WhileStmt& stmt) override {
+            rewrite(stmt.condition);
+            rewriteBranch(stmt.body);
+            return _NIL;
+        }
+
+        RuntimeValue visitForStmt(ForStmt& stmt) override {
+            rewrite(stmt.initializer);
+            rewrite(stmt.condition);
+            rewrite(stmt.increment);
+            rewriteBranch(stmt.body);
+            return _NIL;
+        }
+
+        // The Resolver marks 'return f(...)' as a tail call; a rewritten
+        // value is marked the same way.
+        RuntimeValue visitReturnStmt(ReturnStmt& stmt) override {
+            rewrite(stmt.value);
+            stmt.tailCall = dynamic_cast<CallExpr*>(stmt.value.get()) != nullptr;
+            return _NIL;
+        }
+
+        RuntimeValue visitAssignExpr(AssignExpr& expr) override {
+            rewrite(expr.value);
+            return _NIL;
+        }
+
+        RuntimeValue visitBinaryExpr(BinaryExpr& expr) override {
+            rewrite(expr.left);
+            rewrite(expr.right);
+            return _NIL;
+        }
+
+        RuntimeValue visitCallExpr(CallExpr& expr) override {
+            rewrite(expr.callee);
+            for(auto& argument : expr.arguments) {
+                rewrite(argument);
+            }
+            return _NIL;
+        }
+
+        RuntimeValue visitUnaryExpr(UnaryExpr& expr) override {
+            rewrite(expr.right);
+            return _NIL;
+        }
+
+        RuntimeValue visitGroupingExpr(GroupingExpr& expr) override {
+            rewrite(expr.expression);
+            return _NIL;
+        }
+
+        RuntimeValue visitGetExpr(GetExpr& expr) override {
+            rewrite(expr.object);
+            return _NIL;
+        }
+
+        RuntimeValue visitSetExpr(SetExpr& expr) override {
+            rewrite(expr.object);
+            rewrite(expr.value);
+            return _NIL;
+        }
+
+        RuntimeValue visitSuperExpr(SuperExpr&) override {
+            return _NIL;
+        }
+
+        RuntimeValue visitThisExpr(ThisExpr&) override {
+            return _NIL;
+        }
+
+        RuntimeValue visitLiteralExpr(LiteralExpr&) override {
+            return _NIL;
+        }
+
+        RuntimeValue visitLogicalExpr(LogicalExpr& expr) override {
+            rewrite(expr.left);
+            rewrite(expr.right);
+            return _NIL;
+        }
+
+        RuntimeValue visitVariableExpr(VariableExpr&) override {
+            return _NIL;
+        }
+
+        RuntimeValue visitInlineExpr(InlineExpr& expr) override {
+            for(auto& argument : expr.arguments) {
+                rewrite(argument);
+            }
+            rewrite(expr.body);
+            return _NIL;
+        }
+
+        RuntimeValue visitInvariantExpr(InvariantExpr& expr) override {
+            rewrite(expr.expression);
+            return _NIL;
+        }
+};
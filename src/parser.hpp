@@ -202,11 +202,11 @@ class Parser{
                         }
 
                         LiteralCore convertedValue = performConversion(true, actualType, expected);
-                        return makeExpr<LiteralExpr>(LiteralValue{convertedValue, expected});
+                        return makeExpr<LiteralExpr>(toRuntimeValue(convertedValue));
                     }
                 }
 
-                return makeExpr<LiteralExpr>(LiteralValue{true, actualType});
+                return makeExpr<LiteralExpr>(RuntimeValue(true));
             }
 
             if(match({TokenType::FALSE})) {
@@ -221,11 +221,11 @@ class Parser{
                         }
 
                         LiteralCore convertedValue = performConversion(false, actualType, expected);
-                        return makeExpr<LiteralExpr>(LiteralValue{convertedValue, expected});
+                        return makeExpr<LiteralExpr>(toRuntimeValue(convertedValue));
                     }
                 }
 
-                return makeExpr<LiteralExpr>(LiteralValue{false, actualType});
+                return makeExpr<LiteralExpr>(RuntimeValue(false));
             }
 
             if(match({TokenType::NIL})) {
@@ -240,11 +240,11 @@ class Parser{
                         }
 
                         LiteralCore convertedValue = performConversion(Nil(), actualType, expected);
-                        return makeExpr<LiteralExpr>(LiteralValue{convertedValue, expected});
+                        return makeExpr<LiteralExpr>(toRuntimeValue(convertedValue));
                     }
                 }
 
-                return makeExpr<LiteralExpr>(LiteralValue{Nil(), actualType});
+                return makeExpr<LiteralExpr>(_NIL);
             }
 
             if(match({TokenType::VARIABLE})) {
@@ -266,7 +266,7 @@ class Parser{
                         }
 
                         LiteralCore convertedValue = performConversion(lit.first, actual, expected);
-                        return makeExpr<LiteralExpr>(LiteralValue{convertedValue, expected});
+                        return makeExpr<LiteralExpr>(toRuntimeValue(convertedValue));
                     }
                 }
                 
@@ -276,7 +276,7 @@ class Parser{
                         lit = {val.toDecimal(),"decimal"};
                     }
                 }
-                return makeExpr<LiteralExpr>(lit);
+                return makeExpr<LiteralExpr>(toRuntimeValue(lit.first));
             }
 
             if(match({TokenType::THIS})) {
@@ -21,12 +21,24 @@ enum class ClassType {
     NONE
 };
 
+// A name declared in a local scope and the Environment slot it occupies.
+class Local {
+    public:
+        bool defined;
+        int slot;
+};
+
 class Resolver : public ExprVisitor, public StmtVisitor {
     private:
         Interpreter& interpreter;
-        std::vector<std::unordered_map<std::string, bool>> scopes;
+        std::vector<std::unordered_map<std::string, Local>> scopes;
         FunctionType currentFunction = FunctionType::NONE;
         ClassType currentClass = ClassType::NONE;
+        // Closures declared so far, and the count when each open scope began.
+        // A scope escapes (its Environment must outlive the block or call)
+        // if a function or class is declared while it is open.
+        int closures = 0;
+        std::vector<int> closuresAtScope;
 
         void resolve(const Statement& stmt) {
             stmt->accept(*this);
@@ -38,50 +50,67 @@ class Resolver : public ExprVisitor, public StmtVisitor {
 
         void beginScope() {
             scopes.emplace_back();
+            closuresAtScope.push_back(closures);
         }
 
-        void endScope() {
+        // Pops the innermost scope and returns its frame size.
+        int endScope() {
+            int slots = scopes.back().size();
             scopes.pop_back();
+            closuresAtScope.pop_back();
+            return slots;
+        }
+
+        bool scopeEscapes() const {
+            return closures != closuresAtScope.back();
         }
 
-        void declare(const Token& name) {
-            if (scopes.empty()) return;
+        // Returns the slot the name occupies, or -1 for a global.
+        int declare(const Token& name) {
+            if (scopes.empty()) return -1;
             auto& scope = scopes.back();
             if (scope.contains(name.lexeme)) {
                 throw ParseError(name, "Already a variable with this name in the scope.");
             }
-            scope[name.lexeme] = false;
+            int slot = scope.size();
+            scope[name.lexeme] = Local{false, slot};
+            return slot;
         }
 
         void define(const Token& name) {
             if (!scopes.empty()) {
-                scopes.back()[name.lexeme] = true;
+                scopes.back()[name.lexeme].defined = true;
             }
         }
 
-        void resolveLocal(Expr* expr,const Token& name) {
+        // Writes the scope distance and slot into the node; names not found
+        // in any scope keep depth -1 and are looked up as globals.
+        template <typename Node>
+        void resolveLocal(Node& expr,const Token& name) {
             for(int i = scopes.size() - 1; i >= 0; i--) {
-                if(scopes[i].contains(name.lexeme)) {
-                    int depth = scopes.size() - 1 - i;
-                    interpreter.resolve(expr, depth);
+                auto local = scopes[i].find(name.lexeme);
+                if(local != scopes[i].end()) {
+                    expr.depth = scopes.size() - 1 - i;
+                    expr.slot = local->second.slot;
                     return;
                 }
             }
         }
 
-        void resolveFunction(const FunctionStmt& function, FunctionType type) {
+        void resolveFunction(FunctionStmt& function, FunctionType type) {
             FunctionType enclosingFunction = currentFunction;
             currentFunction = type;
 
             beginScope();
             for(auto& stmt : function.params) {
                 if(auto param = dynamic_cast<VarStmt*>(stmt.get())) {
-                    declare(param->name);
+                    param->slot = declare(param->name);
                     define(param->name);
                 }
             }
             resolve(function.body);
-            endScope();
+            function.escapes = scopeEscapes();
+            function.slots = endScope();
             currentFunction = enclosingFunction;
         }
 
@@ -89,27 +118,37 @@ class Resolver : public ExprVisitor, public StmtVisitor {
 
         Resolver(Interpreter& interpreter) : interpreter(interpreter) {}
 
-        void resolve(const std::vector<Statement>& statements) {
+        // Returns false if resolution failed; slots are then incomplete and
+        // the program must not run.
+        bool resolveProgram(const std::vector<Statement>& statements) {
             try {
-                for(auto& statement : statements) {
-                    resolve(statement);
-                }
+                resolve(statements);
             } catch(ParseError& err) {
                 std::cout << "[Resolver] ParseError: " << err.message() << "\n";
+                return false;
+            }
+            return true;
+        }
+
+        void resolve(const std::vector<Statement>& statements) {
+            for(auto& statement : statements) {
+                resolve(statement);
             }
         }
 
         RuntimeValue visitBlockStmt(BlockStmt& stmt) override {
             beginScope();
             resolve(stmt.statements);
-            endScope();
+            stmt.escapes = scopeEscapes();
+            stmt.slots = endScope();
             return _NIL;
         }
 
         RuntimeValue visitClassStmt(ClassStmt& stmt) override {
             ClassType enclosingClass = currentClass;
             currentClass = ClassType::CLASS;
-            declare(stmt.name);
+            closures++;
+            stmt.slot = declare(stmt.name);
             define(stmt.name);
 
             if(stmt.superclass != nullptr) {
@@ -120,11 +159,11 @@ class Resolver : public ExprVisitor, public StmtVisitor {
                 currentClass = ClassType::SUBCLASS;
                 resolve(stmt.superclass);
                 beginScope();
-                scopes.back()["super"] = true;
+                scopes.back()["super"] = Local{true, 0};
             }
 
             beginScope();
-            scopes.back()["this"] = true;
+            scopes.back()["this"] = Local{true, 0};
 
             for(auto& method : stmt.methods) {
                 FunctionType declaration = FunctionType::METHOD;
@@ -148,7 +187,8 @@ class Resolver : public ExprVisitor, public StmtVisitor {
         }
         
         RuntimeValue visitFunctionStmt(FunctionStmt& stmt) override {
-            declare(stmt.name);
+            closures++;
+            stmt.slot = declare(stmt.name);
             define(stmt.name);
 
             resolveFunction(stmt,FunctionType::FUNCTION);
@@ -183,13 +223,14 @@ class Resolver : public ExprVisitor, public StmtVisitor {
                     throw ParseError(stmt.keyword,"Cannot return a value from an initializer.");
                 }
                 resolve(stmt.value);
+                stmt.tailCall = dynamic_cast<CallExpr*>(stmt.value.get()) != nullptr;
             }
 
             return _NIL;
         }
 
         RuntimeValue visitVarStmt(VarStmt& stmt) override {
-            declare(stmt.name);
+            stmt.slot = declare(stmt.name);
             if(stmt.initializer != nullptr) {
                 resolve(stmt.initializer);
             }
@@ -229,7 +270,7 @@ class Resolver : public ExprVisitor, public StmtVisitor {
             } else if(currentClass != ClassType::SUBCLASS) {
                 throw ParseError(expr.keyword,"Cannot use 'super' in a class with no superclass.");
             }
-            resolveLocal(&expr,expr.keyword);
+            resolveLocal(expr,expr.keyword);
             return _NIL;
         }
 
@@ -238,21 +279,21 @@ class Resolver : public ExprVisitor, public StmtVisitor {
                 throw ParseError(expr.keyword,"Cannot use this outside of a class.");
             }
 
-            resolveLocal(&expr,expr.keyword);
+            resolveLocal(expr,expr.keyword);
             return _NIL;
         }
 
         RuntimeValue visitVariableExpr(VariableExpr& expr) override {
-            if (!scopes.empty() && scopes.back().contains(expr.name.lexeme) && !scopes.back()[expr.name.lexeme]) {
+            if (!scopes.empty() && scopes.back().contains(expr.name.lexeme) && !scopes.back()[expr.name.lexeme].defined) {
                 throw ParseError(expr.name, "Cannot read local variable in its own initializer.");
             }
-            resolveLocal(&expr, expr.name);
+            resolveLocal(expr,expr.name);
             return _NIL;
         }
 
         RuntimeValue visitAssignExpr(AssignExpr& expr) override {
             resolve(expr.value);
-            resolveLocal(&expr, expr.name);
+            resolveLocal(expr,expr.name);
             return _NIL;
         }
 
@@ -292,5 +333,15 @@ class Resolver : public ExprVisitor, public StmtVisitor {
             resolve(expr.right);
             return _NIL;
         }
+
+        // Only made by the Inliner, after resolution.
+        RuntimeValue visitInlineExpr(InlineExpr&) override {
+            return _NIL;
+        }
+
+        // Only made by LoopInvariantCodeMotion, after resolution.
+        RuntimeValue visitInvariantExpr(InvariantExpr&) override {
+            return _NIL;
+        }
 };
 
@@ -1,16 +1,28 @@
+#pragma once
+
 #include "token.hpp"
 #include "util.hpp"
-#include <exception>
+#include <vector>
+
+class Function;
 
-class Return : public std::exception {
+// A 'return' that is still unwinding. visitReturnStmt records one on the
+// Interpreter; blocks and loops stop running statements while it is set,
+// and Function::invoke consumes it.
+class Return {
     public:
-        Token keyword;
+        const Token* keyword;
         RuntimeValue value;
-        std::optional<Token> retType;
+        // Set instead of value for 'return f(...)': the function to run next
+        // in the returning function's place, its arguments, and the instance
+        // for an unbound method (nil otherwise).
+        Ref<Function> callee;
+        std::vector<RuntimeValue> arguments;
+        RuntimeValue receiver;
+        const Token* callName = nullptr;
 
-        const char* what() const noexcept override {
-            return "return";
-        }
+        Return(const Token& keyword,RuntimeValue value) : keyword(&keyword), value(std::move(value)) {}
 
-        Return(Token keyword,RuntimeValue& value,std::optional<Token> retType = std::nullopt) : keyword(keyword), value(value) ,retType(retType) {}
+        Return(const Token& keyword,Ref<Function> callee,std::vector<RuntimeValue> arguments,RuntimeValue receiver,const Token& callName) :
+            keyword(&keyword), callee(std::move(callee)), arguments(std::move(arguments)), receiver(std::move(receiver)), callName(&callName) {}
 };
@@ -0,0 +1,293 @@
+#pragma once
+
+#include "inliner.hpp"
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Walks the statements that follow the declaration of a local holding a
+// new instance, finding the local (at 'slot' of the declaring frame) as
+// the object of a property access.
+class InstanceUses : public OptimizerPass {
+    protected:
+        int slot;
+        // Scopes opened since the local's own.
+        int nesting = 0;
+
+        bool isLocal(const Expression& expr) const {
+            auto variable = dynamic_cast<VariableExpr*>(expr.get());
+            return variable != nullptr && variable->depth == nesting && variable->slot == slot;
+        }
+
+    public:
+        InstanceUses(Interpreter& interpreter,int slot) : OptimizerPass(interpreter), slot(slot) {}
+
+        void scan(std::vector<Statement>& stmts,size_t from) {
+            for(size_t i = from; i < stmts.size(); i++) {
+                rewrite(stmts[i]);
+            }
+        }
+
+        RuntimeValue visitBlockStmt(BlockStmt& stmt) override {
+            nesting++;
+            OptimizerPass::visitBlockStmt(stmt);
+            nesting--;
+            return _NIL;
+        }
+};
+
+// Decides whether the instance escapes: it does unless every use of the
+// local reads or writes one of its known fields. Passing, returning,
+// printing or reassigning the local, calling a method on it (which binds
+// 'this') or stepping a field with '++'/'--' (an error on a property)
+// all count as escaping.
+class EscapeAnalysis : public InstanceUses {
+    private:
+        const std::unordered_set<std::string>& fields;
+
+    public:
+        bool escapes = false;
+
+        EscapeAnalysis(Interpreter& interpreter,int slot,const std::unordered_set<std::string>& fields) :
+            InstanceUses(interpreter,slot), fields(fields) {}
+
+        // The local's frame escapes if any closure is declared in it.
+        RuntimeValue visitFunctionStmt(FunctionStmt&) override {
+            escapes = true;
+            return _NIL;
+        }
+
+        RuntimeValue visitClassStmt(ClassStmt&) override {
+            escapes = true;
+            return _NIL;
+        }
+
+        RuntimeValue visitVariableExpr(VariableExpr& expr) override {
+            if(expr.depth == nesting && expr.slot == slot) escapes = true;
+            return _NIL;
+        }
+
+        RuntimeValue visitAssignExpr(AssignExpr& expr) override {
+            if(expr.depth == nesting && expr.slot == slot) escapes = true;
+            return OptimizerPass::visitAssignExpr(expr);
+        }
+
+        RuntimeValue visitGetExpr(GetExpr& expr) override {
+            if(!isLocal(expr.object)) return OptimizerPass::visitGetExpr(expr);
+            if(!fields.contains(expr.name.lexeme)) escapes = true;
+            return _NIL;
+        }
+
+        RuntimeValue visitSetExpr(SetExpr& expr) override {
+            if(!isLocal(expr.object)) return OptimizerPass::visitSetExpr(expr);
+            if(!fields.contains(expr.name.lexeme)) escapes = true;
+            rewrite(expr.value);
+            return _NIL;
+        }
+
+        RuntimeValue visitUnaryExpr(UnaryExpr& expr) override {
+            auto get = dynamic_cast<GetExpr*>(expr.right.get());
+            bool step = expr.Operator.type != TokenType::MINUS && expr.Operator.type != TokenType::BANG;
+            if(step && get != nullptr && isLocal(get->object)) escapes = true;
+            return OptimizerPass::visitUnaryExpr(expr);
+        }
+};
+
+// Turns the property accesses on a local that does not escape into
+// accesses to the frame slots holding its fields.
+class FieldReplacement : public InstanceUses {
+    private:
+        const std::unordered_map<std::string,int>& fieldSlots;
+
+    public:
+        FieldReplacement(Interpreter& interpreter,int slot,const std::unordered_map<std::string,int>& fieldSlots) :
+            InstanceUses(interpreter,slot), fieldSlots(fieldSlots) {}
+
+        // The read is grouped so that typeOf(), which reports a variable's
+        // declared type, still sees an expression rather than a variable.
+        RuntimeValue visitGetExpr(GetExpr& expr) override {
+            if(!isLocal(expr.object)) return OptimizerPass::visitGetExpr(expr);
+            auto field = makeExpr<VariableExpr>(expr.name);
+            field->depth = nesting;
+            field->slot = fieldSlots.at(expr.name.lexeme);
+            replace(makeExpr<GroupingExpr>(std::move(field)));
+            return _NIL;
+        }
+
+        RuntimeValue visitSetExpr(SetExpr& expr) override {
+            if(!isLocal(expr.object)) return OptimizerPass::visitSetExpr(expr);
+            rewrite(expr.value);
+            Token equal(TokenType::EQUAL,"=",std::nullopt,expr.name.line,expr.name.column);
+            auto field = makeExpr<AssignExpr>(expr.name,equal,std::move(expr.value));
+            field->depth = nesting;
+            field->slot = fieldSlots.at(expr.name.lexeme);
+            replace(std::move(field));
+            return _NIL;
+        }
+};
+
+// Replaces instances that never escape the frame creating them with their
+// fields, held in slots of that frame (-O2).
+//
+// A local declared as 'var p = C(...)' qualifies if:
+//
+//  - C is a global class that is declared once and never assigned, has no
+//    superclass, and its declaration comes in an earlier top-level
+//    statement;
+//  - C's 'init' only assigns fields of 'this', from expressions that read
+//    its parameters and globals but not 'this';
+//  - the call passes as many arguments as 'init' takes;
+//  - p's frame does not escape, and every later use of p reads or writes
+//    one of the fields 'init' assigns (see EscapeAnalysis).
+//
+// The declaration becomes an InlineExpr that stores the arguments in
+// temporaries with the parameter type checks of the call, followed by
+// the field assignments of 'init'; the uses of p become reads and writes
+// of the field slots. No Inst is allocated and no 'init' call is made.
+// Declarations in top-level code outside any block are left alone.
+class ScalarReplacement : public OptimizerPass {
+    private:
+        static constexpr int BUDGET = 48;
+
+        class Constructor {
+            public:
+                FunctionStmt* init;
+                // Assigned by 'init', in order.
+                std::vector<std::string> fields;
+                std::unordered_set<std::string> fieldSet;
+        };
+
+        InlineAnalysis analysis;
+        std::unordered_map<std::string,Constructor> constructors;
+        std::unordered_set<std::string> defined;
+
+        static bool constructor(ClassStmt& klass,Constructor& result) {
+            if(klass.superclass != nullptr) return false;
+
+            FunctionStmt* init = nullptr;
+            for(auto& method : klass.methods) {
+                if(method.name.lexeme != "init") continue;
+                if(init != nullptr) return false;
+                init = &method;
+            }
+            if(init == nullptr) return false;
+
+            int size = 0;
+            result.init = init;
+            for(auto& stmt : init->body) {
+                auto expression = dynamic_cast<ExprStmt*>(stmt.get());
+                auto set = expression != nullptr ? dynamic_cast<SetExpr*>(expression->expression.get()) : nullptr;
+                if(set == nullptr || dynamic_cast<ThisExpr*>(set->object.get()) == nullptr) return false;
+
+                InlineCopy copy(init->name.lexeme);
+                copy.run(set->value);
+                size += copy.size;
+                if(!copy.supported || copy.readsThis || size > BUDGET) return false;
+                if(result.fieldSet.insert(set->name.lexeme).second) result.fields.push_back(set->name.lexeme);
+            }
+            return true;
+        }
+
+        const Constructor* constructorOf(const Expression& initializer) {
+            auto call = dynamic_cast<CallExpr*>(initializer.get());
+            if(call == nullptr) return nullptr;
+            auto callee = dynamic_cast<VariableExpr*>(call->callee.get());
+            if(callee == nullptr || callee->depth >= 0 || !defined.contains(callee->name.lexeme)) return nullptr;
+            auto found = constructors.find(callee->name.lexeme);
+            if(found == constructors.end()) return nullptr;
+            if(found->second.init->params.size() != call->arguments.size()) return nullptr;
+            return &found->second;
+        }
+
+        // The statements that build the fields of 'var p = C(...)'.
+        std::vector<Statement> construct(CallExpr& call,const Constructor& klass,int& slots,
+                                         std::unordered_map<std::string,int>& fieldSlots) {
+            FunctionStmt& init = *klass.init;
+            int base = slots;
+            slots += init.params.size();
+            for(auto& field : klass.fields) {
+                fieldSlots[field] = slots++;
+            }
+
+            std::vector<Statement> stmts;
+            if(!init.params.empty()) {
+                std::vector<TypeTag> types;
+                for(auto& param : init.params) {
+                    types.push_back(typeTagOf(static_cast<VarStmt&>(*param).type.lexeme));
+                }
+                Token var(TokenType::TYPE,"var",std::nullopt,call.paren.line,call.paren.column);
+                auto arguments = makeExpr<InlineExpr>(call.name,std::move(call.arguments),std::move(types),makeExpr<LiteralExpr>(_NIL),call.paren,var);
+                arguments->slot = base;
+                stmts.push_back(makeStmt<ExprStmt>(std::move(arguments)));
+            }
+
+            for(auto& stmt : init.body) {
+                auto& set = static_cast<SetExpr&>(*static_cast<ExprStmt&>(*stmt).expression);
+                Token equal(TokenType::EQUAL,"=",std::nullopt,set.name.line,set.name.column);
+                auto field = makeExpr<AssignExpr>(set.name,equal,InlineCopy(init.name.lexeme,base).run(set.value));
+                field->depth = 0;
+                field->slot = fieldSlots.at(set.name.lexeme);
+                stmts.push_back(makeStmt<ExprStmt>(std::move(field)));
+            }
+            return stmts;
+        }
+
+        void replaceIn(std::vector<Statement>& stmts,int& slots,bool escapes) {
+            if(escapes) return;
+            for(size_t i = 0; i < stmts.size(); i++) {
+                auto var = dynamic_cast<VarStmt*>(stmts[i].get());
+                if(var == nullptr || var->slot < 0 || typeTagOf(var->type.lexeme) != TypeTag::VARIABLE) continue;
+                const Constructor* klass = constructorOf(var->initializer);
+                if(klass == nullptr) continue;
+
+                EscapeAnalysis analysis(interpreter,var->slot,klass->fieldSet);
+                analysis.scan(stmts,i + 1);
+                if(analysis.escapes) continue;
+
+                std::unordered_map<std::string,int> fieldSlots;
+                auto& call = static_cast<CallExpr&>(*var->initializer);
+                std::vector<Statement> fields = construct(call,*klass,slots,fieldSlots);
+                FieldReplacement(interpreter,var->slot,fieldSlots).scan(stmts,i + 1);
+
+                size_t count = fields.size();
+                stmts.erase(stmts.begin() + i);
+                stmts.insert(stmts.begin() + i,std::make_move_iterator(fields.begin()),std::make_move_iterator(fields.end()));
+                i += count;
+                i--;
+            }
+        }
+
+    public:
+        ScalarReplacement(Interpreter& interpreter) : OptimizerPass(interpreter), analysis(interpreter) {}
+
+        void run(std::vector<Statement>& program) override {
+            analysis.run(program);
+            for(auto& stmt : program) {
+                rewrite(stmt);
+                auto klass = dynamic_cast<ClassStmt*>(stmt.get());
+                if(klass == nullptr) continue;
+
+                const std::string& name = klass->name.lexeme;
+                Constructor found;
+                if(analysis.globalDeclarations[name] == 1 && analysis.classDeclarations[name] == 1 &&
+                   !analysis.assignedGlobals.contains(name) && constructor(*klass,found)) {
+                    constructors.emplace(name,std::move(found));
+                    defined.insert(name);
+                }
+            }
+            std::erase(program,nullptr);
+        }
+
+        RuntimeValue visitBlockStmt(BlockStmt& stmt) override {
+            OptimizerPass::visitBlockStmt(stmt);
+            replaceIn(stmt.statements,stmt.slots,stmt.escapes);
+            return _NIL;
+        }
+
+        RuntimeValue visitFunctionStmt(FunctionStmt& stmt) override {
+            OptimizerPass::visitFunctionStmt(stmt);
+            replaceIn(stmt.body,stmt.slots,stmt.escapes);
+            return _NIL;
+        }
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// The layout of an instance's fields: which name lives in which slot.
+// Instances that gained the same fields in the same order share one Shape,
+// so an Inst stores only a Shape pointer and a vector of values.
+//
+// Shapes form a tree rooted at the empty shape; adding a field follows (or
+// creates) the transition for that name. They are never freed: there is
+// one per distinct field order the program builds, and ids are never
+// reused by inline caches.
+class Shape {
+    private:
+        std::unordered_map<std::string,uint32_t> slots;
+        std::unordered_map<std::string,std::unique_ptr<Shape>> transitions;
+
+        Shape() : id(nextId()) {}
+
+        static uint32_t nextId() {
+            static uint32_t next = 0;
+            return ++next;
+        }
+
+    public:
+        const uint32_t id;
+
+        Shape(const Shape&) = delete;
+        Shape& operator=(const Shape&) = delete;
+
+        static Shape* root() {
+            static Shape* empty = new Shape();
+            return empty;
+        }
+
+        uint32_t size() const {
+            return slots.size();
+        }
+
+        // Returns the slot of the field, or -1 if this shape lacks it.
+        int find(const std::string& name) const {
+            auto slot = slots.find(name);
+            return slot == slots.end() ? -1 : slot->second;
+        }
+
+        // The shape with name appended as the next slot.
+        Shape* withField(const std::string& name) {
+            std::unique_ptr<Shape>& next = transitions[name];
+            if(next == nullptr) {
+                next.reset(new Shape());
+                next->slots = slots;
+                next->slots.emplace(name,slots.size());
+            }
+            return next.get();
+        }
+};
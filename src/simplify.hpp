@@ -0,0 +1,171 @@
+#pragma once
+
+#include "binaryOps.hpp"
+#include "optimizerPass.hpp"
+
+// Evaluates operators whose operands are all literals, using the
+// interpreter's own operations.
+//
+// Only operations that can neither fail nor warn are folded: both operands
+// of a binary operator must already have the same type, so nothing is
+// promoted and no ImplicitConversionWarning is skipped or moved, and
+// division by zero is left to fail at run time.
+class ConstantFolding : public OptimizerPass {
+    private:
+        static bool foldable(BinaryOp op,TypeTag left,TypeTag right) {
+            if(op == BinaryOp::COUNT || left != right) return false;
+            switch(left) {
+                case TypeTag::INTEGER:
+                case TypeTag::DECIMAL:
+                case TypeTag::BIG_DECIMAL:
+                    return true;
+                case TypeTag::STRING:
+                    return binary::isComparison(op) || op == BinaryOp::PLUS;
+                case TypeTag::BOOLEAN:
+                    return binary::isComparison(op);
+                default:
+                    return false;
+            }
+        }
+
+    public:
+        using OptimizerPass::OptimizerPass;
+
+        RuntimeValue visitBinaryExpr(BinaryExpr& expr) override {
+            rewrite(expr.left);
+            rewrite(expr.right);
+            LiteralExpr* left = literal(expr.left);
+            LiteralExpr* right = literal(expr.right);
+            if(left == nullptr || right == nullptr) return _NIL;
+            if(!foldable(binaryOpOf(expr.Operator.type),left->literal.typeTag(),right->literal.typeTag())) return _NIL;
+
+            try {
+                replace(makeExpr<LiteralExpr>(interpreter.binaryOp(expr.Operator,left->literal,right->literal)));
+            } catch(RuntimeError&) {
+                // Divide or modulo by zero: report it when it runs.
+            }
+            return _NIL;
+        }
+
+        // '++'/'--' report different errors for a literal operand and any
+        // other one, so their operand is left exactly as written.
+        RuntimeValue visitUnaryExpr(UnaryExpr& expr) override {
+            if(expr.Operator.type != TokenType::MINUS && expr.Operator.type != TokenType::BANG) return _NIL;
+
+            rewrite(expr.right);
+            LiteralExpr* right = literal(expr.right);
+            if(right == nullptr) return _NIL;
+            if(expr.Operator.type == TokenType::MINUS && !binary::isNumeric(right->literal.typeTag())) return _NIL;
+
+            replace(makeExpr<LiteralExpr>(interpreter.unaryOp(expr.Operator,right->literal)));
+            return _NIL;
+        }
+
+        RuntimeValue visitGroupingExpr(GroupingExpr& expr) override {
+            rewrite(expr.expression);
+            if(literal(expr.expression) != nullptr) replace(std::move(expr.expression));
+            return _NIL;
+        }
+
+        RuntimeValue visitLogicalExpr(LogicalExpr& expr) override {
+            rewrite(expr.left);
+            rewrite(expr.right);
+            LiteralExpr* left = literal(expr.left);
+            if(left == nullptr) return _NIL;
+
+            bool truthy = interpreter.isTruthy(left->literal);
+            switch(expr.Operator.type) {
+                case TokenType::OR:
+                    replace(std::move(truthy ? expr.left : expr.right));
+                    break;
+                case TokenType::AND:
+                    replace(std::move(truthy ? expr.right : expr.left));
+                    break;
+                case TokenType::PIPE_PIPE:
+                case TokenType::AMP_AMP: {
+                    // These always produce a boolean, so the right operand
+                    // can only stand in for the whole if it is a literal.
+                    bool shortCircuits = truthy == (expr.Operator.type == TokenType::PIPE_PIPE);
+                    if(shortCircuits) {
+                        replace(makeExpr<LiteralExpr>(truthy));
+                    } else if(LiteralExpr* right = literal(expr.right)) {
+                        replace(makeExpr<LiteralExpr>(interpreter.isTruthy(right->literal)));
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+            return _NIL;
+        }
+};
+
+// Drops the branches and loops a literal condition rules out.
+class BranchPruning : public OptimizerPass {
+    public:
+        using OptimizerPass::OptimizerPass;
+
+        RuntimeValue visitIfStmt(IfStmt& stmt) override {
+            OptimizerPass::visitIfStmt(stmt);
+
+            // A literal 'elif' either always wins or never runs.
+            if(LiteralExpr* elif = literal(stmt.elifCondition)) {
+                if(interpreter.isTruthy(elif->literal)) stmt.elseBranch = std::move(stmt.elifBranch);
+                stmt.elifCondition = nullptr;
+                stmt.elifBranch = nullptr;
+            }
+
+            LiteralExpr* condition = literal(stmt.ifCondition);
+            if(condition == nullptr) return _NIL;
+
+            if(interpreter.isTruthy(condition->literal)) {
+                replace(std::move(stmt.thenBranch));
+            } else if(stmt.elifCondition != nullptr) {
+                replace(makeStmt<IfStmt>(std::move(stmt.elifCondition),std::move(stmt.elifBranch),nullptr,nullptr,std::move(stmt.elseBranch)));
+            } else {
+                replace(std::move(stmt.elseBranch));
+            }
+            return _NIL;
+        }
+
+        RuntimeValue visitWhileStmt(WhileStmt& stmt) override {
+            OptimizerPass::visitWhileStmt(stmt);
+            LiteralExpr* condition = literal(stmt.condition);
+            if(condition != nullptr && !interpreter.isTruthy(condition->literal)) replace(Statement());
+            return _NIL;
+        }
+
+        // The initializer still runs once before a false condition.
+        RuntimeValue visitForStmt(ForStmt& stmt) override {
+            OptimizerPass::visitForStmt(stmt);
+            LiteralExpr* condition = literal(stmt.condition);
+            if(condition != nullptr && !interpreter.isTruthy(condition->literal)) replace(std::move(stmt.initializer));
+            return _NIL;
+        }
+};
+
+// Removes statements that follow a 'return' in the same block.
+class DeadCodeElimination : public OptimizerPass {
+    private:
+        static void dropAfterReturn(std::vector<Statement>& stmts) {
+            auto ret = std::find_if(stmts.begin(),stmts.end(),[](const Statement& stmt) {
+                return dynamic_cast<ReturnStmt*>(stmt.get()) != nullptr;
+            });
+            if(ret != stmts.end()) stmts.erase(ret + 1,stmts.end());
+        }
+
+    public:
+        using OptimizerPass::OptimizerPass;
+
+        RuntimeValue visitBlockStmt(BlockStmt& stmt) override {
+            OptimizerPass::visitBlockStmt(stmt);
+            dropAfterReturn(stmt.statements);
+            return _NIL;
+        }
+
+        RuntimeValue visitFunctionStmt(FunctionStmt& stmt) override {
+            OptimizerPass::visitFunctionStmt(stmt);
+            dropAfterReturn(stmt.body);
+            return _NIL;
+        }
+};
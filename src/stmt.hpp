@@ -46,6 +46,8 @@ public:
 class BlockStmt : public Stmt {
 public:
 	std::vector<Statement> statements;
+	int slots = 0;
+	bool escapes = false;
 
 	BlockStmt(std::vector<Statement>&& statements) : statements(std::move(statements)) {}
 	RuntimeValue accept(StmtVisitor& visitor) override {
@@ -58,6 +60,7 @@ public:
 	Token name;
 	Expression superclass;
 	std::vector<FunctionStmt> methods;
+	int slot = -1;
 
 	ClassStmt(Token name, Expression superclass, std::vector<FunctionStmt>&& methods) : name(name), superclass(std::move(superclass)), methods(std::move(methods)) {}
 	RuntimeValue accept(StmtVisitor& visitor) override {
@@ -90,6 +93,7 @@ public:
 	Token name;
 	Token type;
 	Expression initializer;
+	int slot = -1;
 
 	VarStmt(Token name, Token type, Expression initializer) : name(name), type(type), initializer(std::move(initializer)) {}
 	RuntimeValue accept(StmtVisitor& visitor) override {
@@ -104,6 +108,9 @@ public:
 	std::vector<Statement> params;
 	std::vector<Statement> body;
 	Token returnType;
+	int slot = -1;
+	int slots = 0;
+	bool escapes = false;
 
 	FunctionStmt(Token name, std::string kind, std::vector<Statement>&& params, std::vector<Statement>&& body, Token returnType) : name(name), kind(kind), params(std::move(params)), body(std::move(body)), returnType(returnType) {}
 	RuntimeValue accept(StmtVisitor& visitor) override {
@@ -129,6 +136,8 @@ class WhileStmt : public Stmt {
 public:
 	Expression condition;
 	Statement body;
+	int invariantSlot = -1;
+	int invariants = 0;
 
 	WhileStmt(Expression condition, Statement body) : condition(std::move(condition)), body(std::move(body)) {}
 	RuntimeValue accept(StmtVisitor& visitor) override {
@@ -142,6 +151,9 @@ public:
 	Expression condition;
 	Expression increment;
 	Statement body;
+	int invariantSlot = -1;
+	int invariants = 0;
+	int step = 0;
 
 	ForStmt(Statement initializer, Expression condition, Expression increment, Statement body) : initializer(std::move(initializer)), condition(std::move(condition)), increment(std::move(increment)), body(std::move(body)) {}
 	RuntimeValue accept(StmtVisitor& visitor) override {
@@ -154,6 +166,7 @@ public:
 	Token keyword;
 	Expression value;
 	Token retType;
+	bool tailCall = false;
 
 	ReturnStmt(Token keyword, Expression value, Token retType) : keyword(keyword), value(std::move(value)), retType(retType) {}
 	RuntimeValue accept(StmtVisitor& visitor) override {
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Runtime type of a value, plus the declaration-only kinds an Environment
+// slot can carry (a 'var' slot, a 'super' binding) and the tag of a heap
+// Environment itself.
+enum class TypeTag : uint8_t {
+    NIL,
+    BOOLEAN,
+    INTEGER,
+    DECIMAL,
+    BIG_DECIMAL,
+    STRING,
+    TYPE,
+    FUNCTION,
+    CLASS,
+    INSTANCE,
+    VARIABLE,
+    SUPERCLASS,
+    ENVIRONMENT
+};
+
+constexpr size_t TYPE_TAG_COUNT = static_cast<size_t>(TypeTag::ENVIRONMENT) + 1;
+
+// Promotion lattice for binary operators: boolean < integer < decimal <
+// BigDecimal < string. The operand with the lower priority is promoted to
+// the type of the other one.
+constexpr int typePriority(TypeTag tag) {
+    switch(tag) {
+        case TypeTag::BOOLEAN:     return 0;
+        case TypeTag::INTEGER:     return 1;
+        case TypeTag::DECIMAL:     return 2;
+        case TypeTag::BIG_DECIMAL: return 3;
+        case TypeTag::STRING:      return 4;
+        default:                   return -1;
+    }
+}
+
+constexpr TypeTag promotedType(TypeTag left,TypeTag right) {
+    return typePriority(left) > typePriority(right) ? left : right;
+}
+
+// Implicit conversions promoteType is allowed to perform.
+constexpr bool canPromote(TypeTag from,TypeTag to) {
+    switch(from) {
+        case TypeTag::NIL:
+            return to == TypeTag::INTEGER || to == TypeTag::DECIMAL || to == TypeTag::BIG_DECIMAL || to == TypeTag::BOOLEAN;
+        case TypeTag::BOOLEAN:
+            return to == TypeTag::INTEGER || to == TypeTag::DECIMAL || to == TypeTag::BIG_DECIMAL;
+        case TypeTag::INTEGER:
+            return to == TypeTag::DECIMAL || to == TypeTag::BIG_DECIMAL;
+        case TypeTag::DECIMAL:
+            return to == TypeTag::BIG_DECIMAL;
+        default:
+            return false;
+    }
+}
+
+static_assert(promotedType(TypeTag::INTEGER,TypeTag::DECIMAL) == TypeTag::DECIMAL);
+static_assert(promotedType(TypeTag::BOOLEAN,TypeTag::INTEGER) == TypeTag::INTEGER);
+static_assert(promotedType(TypeTag::NIL,TypeTag::BIG_DECIMAL) == TypeTag::BIG_DECIMAL);
+static_assert(canPromote(TypeTag::INTEGER,TypeTag::BIG_DECIMAL) && !canPromote(TypeTag::DECIMAL,TypeTag::INTEGER));
+
+inline const std::string& typeName(TypeTag tag) {
+    static const std::string names[TYPE_TAG_COUNT] = {
+        "nil", "boolean", "integer", "decimal", "BigDecimal", "string",
+        "type", "function", "class", "instance", "variable", "superclass",
+        "environment"
+    };
+    return names[static_cast<size_t>(tag)];
+}
+
+// Maps a declared type or declaration kind to its tag.
+inline TypeTag typeTagOf(std::string_view name) {
+    if(name == "var" || name == "variable") return TypeTag::VARIABLE;
+    if(name == "int" || name == "integer") return TypeTag::INTEGER;
+    if(name == "decimal") return TypeTag::DECIMAL;
+    if(name == "BigDecimal") return TypeTag::BIG_DECIMAL;
+    if(name == "string") return TypeTag::STRING;
+    if(name == "boolean") return TypeTag::BOOLEAN;
+    if(name == "function" || name == "method") return TypeTag::FUNCTION;
+    if(name == "class") return TypeTag::CLASS;
+    if(name == "superclass") return TypeTag::SUPERCLASS;
+    return TypeTag::NIL;
+}
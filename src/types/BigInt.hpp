@@ -1,42 +1,672 @@
 #pragma once
 
+#include <algorithm>
+#include <cctype>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
-#include <ctime>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <ostream>
 #include <stdexcept>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 class BigDecimal;
 class BigInt {
     private:
-        std::vector<uint8_t> digits;
+        using Limb = uint64_t;
+        using Wide = unsigned __int128;
+        using Limbs = std::vector<Limb>;
+
+        // 10^19, the largest power of ten a limb holds: decimal text is
+        // converted 19 digits at a time.
+        static constexpr Limb DECIMAL_BASE = 10000000000000000000ULL;
+        static constexpr size_t DECIMAL_DIGITS = 19;
+        // Multiplication tiers, by the shorter operand's limbs.
+        static constexpr size_t KARATSUBA_THRESHOLD = 32;
+        static constexpr size_t TOOM3_THRESHOLD = 450;
+        static constexpr size_t NTT_THRESHOLD = 14000;
+        // Divisors of this many limbs, with a quotient of at least
+        // BURNIKEL_ZIEGLER_OFFSET more, are divided recursively.
+        static constexpr size_t BURNIKEL_ZIEGLER_THRESHOLD = 80;
+        static constexpr size_t BURNIKEL_ZIEGLER_OFFSET = 40;
+
+        // The magnitude in base 2^64, least significant limb first, without
+        // high zero limbs (zero has none).
+        Limbs limbs;
         bool isNegative = false;
 
-    public:
-        BigInt() : digits(1, 0), isNegative(false) {}
-        BigInt(const std::string& str) { parseFromString(str); }
-        BigInt(uint8_t digit) { digits.push_back(digit); }
-        BigInt(size_t digit) {digits.push_back(digit); }
-        BigInt(int num) { *this = BigInt(std::to_string(num)); }
-        BigInt(int64_t num) { *this = BigInt(std::to_string(num)); }
+        BigInt(Limbs&& magnitude, bool negative) : limbs(std::move(magnitude)), isNegative(negative) {
+            removeLeadingZeros();
+        }
 
-        void removeLeadingZeros() {
-            while (digits.size() > 1 && digits.back() == 0) {
-                digits.pop_back();
+        static void trim(Limbs& a) {
+            while (!a.empty() && a.back() == 0) {
+                a.pop_back();
+            }
+        }
+
+        static int compareMagnitude(const Limbs& a, const Limbs& b) {
+            if (a.size() != b.size()) return a.size() > b.size() ? 1 : -1;
+            for (size_t i = a.size(); i-- > 0;) {
+                if (a[i] != b[i]) return a[i] > b[i] ? 1 : -1;
+            }
+            return 0;
+        }
+
+        // a += b * 2^(64 * shift).
+        static void addTo(Limbs& a, const Limbs& b, size_t shift = 0) {
+            if (a.size() < b.size() + shift) a.resize(b.size() + shift, 0);
+            Limb carry = 0;
+            size_t i = 0;
+            for (; i < b.size(); i++) {
+                Wide sum = static_cast<Wide>(a[i + shift]) + b[i] + carry;
+                a[i + shift] = static_cast<Limb>(sum);
+                carry = static_cast<Limb>(sum >> 64);
+            }
+            for (i += shift; carry != 0 && i < a.size(); i++) {
+                carry = ++a[i] == 0;
+            }
+            if (carry != 0) a.push_back(carry);
+        }
+
+        // a -= b, for a trimmed b no larger than a.
+        static void subtractFrom(Limbs& a, const Limbs& b) {
+            Limb borrow = 0;
+            size_t i = 0;
+            for (; i < b.size(); i++) {
+                Limb diff = a[i] - b[i];
+                Limb next = (a[i] < b[i]) | (diff < borrow);
+                a[i] = diff - borrow;
+                borrow = next;
+            }
+            for (; borrow != 0 && i < a.size(); i++) {
+                borrow = a[i]-- == 0;
+            }
+            trim(a);
+        }
+
+        // a = a * factor + addend.
+        static void multiplyAdd(Limbs& a, Limb factor, Limb addend) {
+            Limb carry = addend;
+            for (Limb& limb : a) {
+                Wide product = static_cast<Wide>(limb) * factor + carry;
+                limb = static_cast<Limb>(product);
+                carry = static_cast<Limb>(product >> 64);
+            }
+            if (carry != 0) a.push_back(carry);
+        }
+
+        // a /= divisor, returning the remainder.
+        static Limb divideByLimb(Limbs& a, Limb divisor) {
+            Wide remainder = 0;
+            for (size_t i = a.size(); i-- > 0;) {
+                Wide current = (remainder << 64) | a[i];
+                a[i] = static_cast<Limb>(current / divisor);
+                remainder = current % divisor;
+            }
+            trim(a);
+            return static_cast<Limb>(remainder);
+        }
+
+        // a[0, n) += b[0, m) for m <= n, returning the carry out.
+        static Limb addLimbs(Limb* a, size_t n, const Limb* b, size_t m) {
+            Limb carry = 0;
+            size_t i = 0;
+            for (; i < m; i++) {
+                Wide sum = static_cast<Wide>(a[i]) + b[i] + carry;
+                a[i] = static_cast<Limb>(sum);
+                carry = static_cast<Limb>(sum >> 64);
+            }
+            for (; carry != 0 && i < n; i++) {
+                carry = ++a[i] == 0;
             }
+            return carry;
+        }
 
-            if (digits.size() == 1 && digits[0] == 0) {
-                isNegative = false;
+        // a[0, n) -= b[0, m) for m <= n, returning the borrow out.
+        static Limb subtractLimbs(Limb* a, size_t n, const Limb* b, size_t m) {
+            Limb borrow = 0;
+            size_t i = 0;
+            for (; i < m; i++) {
+                Limb diff = a[i] - b[i];
+                Limb next = (a[i] < b[i]) | (diff < borrow);
+                a[i] = diff - borrow;
+                borrow = next;
             }
+            for (; borrow != 0 && i < n; i++) {
+                borrow = a[i]-- == 0;
+            }
+            return borrow;
+        }
+
+        // out[0, n) = |a[0, n) - b[0, m)| for m <= n; true if b is larger.
+        static bool absoluteDifference(const Limb* a, size_t n, const Limb* b, size_t m, Limb* out) {
+            size_t i = n;
+            while (i > m && a[i - 1] == 0) i--;
+            bool less = false;
+            if (i == m) {
+                while (i > 0 && a[i - 1] == b[i - 1]) i--;
+                less = i > 0 && a[i - 1] < b[i - 1];
+            }
+            if (less) {
+                std::copy(b, b + m, out);
+                std::fill(out + m, out + n, 0);
+                subtractLimbs(out, n, a, n);
+            } else {
+                std::copy(a, a + n, out);
+                subtractLimbs(out, n, b, m);
+            }
+            return less;
+        }
+
+        // out[0, n + m) = a[0, n) * b[0, m).
+        static void naiveMultiply(const Limb* a, size_t n, const Limb* b, size_t m, Limb* out) {
+            std::fill(out, out + n + m, 0);
+            for (size_t i = 0; i < n; i++) {
+                Limb carry = 0;
+                for (size_t j = 0; j < m; j++) {
+                    Wide product = static_cast<Wide>(a[i]) * b[j] + out[i + j] + carry;
+                    out[i + j] = static_cast<Limb>(product);
+                    carry = static_cast<Limb>(product >> 64);
+                }
+                out[i + m] = carry;
+            }
+        }
+
+        // The working space karatsubaMultiply() needs for n limbs.
+        static size_t karatsubaScratch(size_t n) {
+            if (n <= KARATSUBA_THRESHOLD) return 0;
+            size_t low = n - n / 2;
+            return 4 * low + std::max(karatsubaScratch(low), 2 * low + 1);
+        }
+
+        // out[0, 2n) = a[0, n) * b[0, n). With a = a1 * X + a0 and likewise
+        // b, the middle term a0 * b1 + a1 * b0 is z0 + z2 - (a0 - a1)(b0 - b1):
+        // the differences keep every operand within its half, so the three
+        // products and the sums all fit in 'out' and 'scratch'.
+        static void karatsubaMultiply(const Limb* a, const Limb* b, size_t n, Limb* out, Limb* scratch) {
+            if (n <= KARATSUBA_THRESHOLD) {
+                naiveMultiply(a, n, b, n, out);
+                return;
+            }
+
+            size_t low = n - n / 2, high = n / 2;
+            karatsubaMultiply(a, b, low, out, scratch);
+            karatsubaMultiply(a + low, b + low, high, out + 2 * low, scratch);
+
+            Limb* da = scratch;
+            Limb* db = scratch + low;
+            Limb* product = scratch + 2 * low;
+            Limb* middle = scratch + 4 * low;
+            bool negative = absoluteDifference(a, low, a + low, high, da) != absoluteDifference(b, low, b + low, high, db);
+            karatsubaMultiply(da, db, low, product, middle);
+
+            std::copy(out, out + 2 * low, middle);
+            middle[2 * low] = addLimbs(middle, 2 * low, out + 2 * low, 2 * high);
+            if (negative) addLimbs(middle, 2 * low + 1, product, 2 * low);
+            else subtractLimbs(middle, 2 * low + 1, product, 2 * low);
+
+            size_t span = std::min(2 * low + 1, 2 * n - low);
+            addLimbs(out + low, 2 * n - low, middle, span);
+        }
+
+        // x / divisor for a divisor that divides x.
+        static BigInt exactDivide(const BigInt& x, Limb divisor) {
+            Limbs quotient = x.limbs;
+            divideByLimb(quotient, divisor);
+            return BigInt(std::move(quotient), x.isNegative);
+        }
+
+        // Toom-3: each operand is split into three parts, as a polynomial in
+        // X = 2^(64k), and the product is interpolated from five products a
+        // third the size, at X = 0, 1, -1, -2 and infinity (Bodrato's
+        // sequence, which only needs exact halving and division by 3).
+        static Limbs toom3Multiply(const Limbs& a, const Limbs& b) {
+            size_t k = (std::max(a.size(), b.size()) + 2) / 3;
+            BigInt a0(limbRange(a, 0, k), false), a1(limbRange(a, k, 2 * k), false), a2(limbRange(a, 2 * k, a.size()), false);
+            BigInt b0(limbRange(b, 0, k), false), b1(limbRange(b, k, 2 * k), false), b2(limbRange(b, 2 * k, b.size()), false);
+
+            BigInt pa = a0 + a2, pb = b0 + b2;
+            BigInt aOne = pa + a1, bOne = pb + b1;
+            BigInt aMinusOne = pa - a1, bMinusOne = pb - b1;
+            BigInt aMinusTwo = aMinusOne + a2, bMinusTwo = bMinusOne + b2;
+            aMinusTwo = aMinusTwo + aMinusTwo - a0;
+            bMinusTwo = bMinusTwo + bMinusTwo - b0;
+
+            BigInt r0 = a0 * b0;
+            BigInt r1 = aOne * bOne;
+            BigInt rMinusOne = aMinusOne * bMinusOne;
+            BigInt rMinusTwo = aMinusTwo * bMinusTwo;
+            BigInt rInfinity = a2 * b2;
+
+            BigInt r3 = exactDivide(rMinusTwo - r1, 3);
+            r1 = exactDivide(r1 - rMinusOne, 2);
+            BigInt r2 = rMinusOne - r0;
+            r3 = exactDivide(r2 - r3, 2) + rInfinity + rInfinity;
+            r2 = r2 + r1 - rInfinity;
+            r1 = r1 - r3;
+
+            Limbs result = std::move(r0.limbs);
+            addTo(result, r1.limbs, k);
+            addTo(result, r2.limbs, 2 * k);
+            addTo(result, r3.limbs, 3 * k);
+            addTo(result, rInfinity.limbs, 4 * k);
+            trim(result);
+            return result;
+        }
+
+        // Arithmetic modulo a prime p < 2^62 with 2^40 | p - 1, on values in
+        // Montgomery form (x held as x * 2^64 mod p).
+        class Modulus {
+            public:
+                Limb p;
+                Limb root;
+                // -p^-1 mod 2^64, and 2^128 mod p.
+                Limb negInverse;
+                Limb rSquared;
+
+                Modulus(Limb p, Limb root) : p(p), root(root) {
+                    Limb inverse = p;
+                    for (int i = 0; i < 5; i++) {
+                        inverse *= 2 - p * inverse;
+                    }
+                    negInverse = 0 - inverse;
+                    Limb r = (0 - p) % p;
+                    rSquared = static_cast<Limb>(static_cast<Wide>(r) * r % p);
+                }
+
+                // The conditional subtractions are written as min() of the
+                // two candidates (one of them wraps around) to stay branchless.
+                Limb reduce(Wide t) const {
+                    Limb m = static_cast<Limb>(t) * negInverse;
+                    Limb r = static_cast<Limb>((t + static_cast<Wide>(m) * p) >> 64);
+                    return std::min(r, r - p);
+                }
+
+                Limb multiply(Limb a, Limb b) const {
+                    return reduce(static_cast<Wide>(a) * b);
+                }
+
+                Limb add(Limb a, Limb b) const {
+                    Limb sum = a + b;
+                    return std::min(sum, sum - p);
+                }
+
+                Limb subtract(Limb a, Limb b) const {
+                    Limb diff = a - b;
+                    return std::min(diff, diff + p);
+                }
+
+                // For x < p.
+                Limb toMontgomery(Limb x) const {
+                    return multiply(x, rSquared);
+                }
+
+                Limb power(Limb base, Limb exponent) const {
+                    Limb result = toMontgomery(1);
+                    while (exponent != 0) {
+                        if (exponent & 1) result = multiply(result, base);
+                        base = multiply(base, base);
+                        exponent >>= 1;
+                    }
+                    return result;
+                }
+        };
+
+        static const Modulus& nttPrime(int index) {
+            static const Modulus primes[2] = {Modulus(0x3fffc00000000001ULL, 11), Modulus(0x3fffbe0000000001ULL, 3)};
+            return primes[index];
+        }
+
+        // The iterative radix-2 number-theoretic transform of a (whose size
+        // is a power of two) modulo 'mod', or its inverse.
+        static void transform(Limbs& a, const Modulus& mod, bool invert) {
+            size_t n = a.size();
+            for (size_t i = 1, j = 0; i < n; i++) {
+                size_t bit = n >> 1;
+                for (; j & bit; bit >>= 1) {
+                    j ^= bit;
+                }
+                j ^= bit;
+                if (i < j) std::swap(a[i], a[j]);
+            }
+
+            Limb root = mod.power(mod.toMontgomery(mod.root), (mod.p - 1) / n);
+            if (invert) root = mod.power(root, n - 1);
+            Limbs roots(std::max<size_t>(n / 2, 1));
+            roots[0] = mod.toMontgomery(1);
+            for (size_t i = 1; i < roots.size(); i++) {
+                roots[i] = mod.multiply(roots[i - 1], root);
+            }
+
+            for (size_t length = 2; length <= n; length <<= 1) {
+                size_t half = length / 2, stride = n / length;
+                for (size_t i = 0; i < n; i += length) {
+                    for (size_t j = 0; j < half; j++) {
+                        Limb u = a[i + j];
+                        Limb v = mod.multiply(a[i + j + half], roots[j * stride]);
+                        a[i + j] = mod.add(u, v);
+                        a[i + j + half] = mod.subtract(u, v);
+                    }
+                }
+            }
+
+            if (invert) {
+                Limb scale = mod.power(mod.toMontgomery(n), mod.p - 2);
+                for (Limb& x : a) {
+                    x = mod.multiply(x, scale);
+                }
+            }
+        }
+
+        // Convolves the operands' 32-bit halves modulo two primes and
+        // recombines each coefficient (below 2^104) by the Chinese remainder
+        // theorem before carrying.
+        static Limbs nttMultiply(const Limbs& a, const Limbs& b) {
+            size_t n = 1;
+            while (n < 2 * (a.size() + b.size())) {
+                n <<= 1;
+            }
+
+            Limbs residues[2];
+            for (int k = 0; k < 2; k++) {
+                const Modulus& mod = nttPrime(k);
+                Limbs fa(n, 0), fb(n, 0);
+                for (size_t i = 0; i < a.size(); i++) {
+                    fa[2 * i] = mod.toMontgomery(a[i] & 0xffffffff);
+                    fa[2 * i + 1] = mod.toMontgomery(a[i] >> 32);
+                }
+                for (size_t i = 0; i < b.size(); i++) {
+                    fb[2 * i] = mod.toMontgomery(b[i] & 0xffffffff);
+                    fb[2 * i + 1] = mod.toMontgomery(b[i] >> 32);
+                }
+                transform(fa, mod, false);
+                transform(fb, mod, false);
+                for (size_t i = 0; i < n; i++) {
+                    fa[i] = mod.multiply(fa[i], fb[i]);
+                }
+                transform(fa, mod, true);
+                for (Limb& x : fa) {
+                    x = mod.reduce(x);
+                }
+                residues[k] = std::move(fa);
+            }
+
+            // x = r1 + p1 * ((r2 - r1) * p1^-1 mod p2), with p1^-1 mod p2 in
+            // Montgomery form so one multiply reduces the product. r1 < p1
+            // is below 2 * p2, so subtracting it needs at most one p2 more.
+            const Modulus& second = nttPrime(1);
+            const Limb p1 = nttPrime(0).p;
+            const Limb inverse = second.toMontgomery(0x3fffbdffffe00022ULL);
+            Limbs result(a.size() + b.size(), 0);
+            Wide carry = 0;
+            for (size_t i = 0; i < 2 * result.size(); i++) {
+                Limb r1 = residues[0][i], r2 = residues[1][i];
+                Limb diff = second.subtract(r2, std::min(r1, r1 - second.p));
+                Limb t = second.multiply(diff, inverse);
+                carry += static_cast<Wide>(p1) * t + r1;
+                result[i / 2] |= static_cast<Limb>(carry & 0xffffffff) << (32 * (i % 2));
+                carry >>= 32;
+            }
+            trim(result);
+            return result;
+        }
+
+        // Picks the multiplication by operand size: schoolbook, Karatsuba,
+        // Toom-3 and then NTT. A much longer operand is multiplied a piece
+        // the size of the shorter one at a time, below the NTT tier.
+        static Limbs multiplyMagnitude(const Limbs& a, const Limbs& b) {
+            const Limbs& longer = a.size() >= b.size() ? a : b;
+            const Limbs& shorter = a.size() >= b.size() ? b : a;
+            size_t n = shorter.size(), m = longer.size();
+            if (n == 0) return Limbs();
+
+            Limbs result;
+            if (n <= KARATSUBA_THRESHOLD) {
+                result.resize(n + m);
+                naiveMultiply(longer.data(), m, shorter.data(), n, result.data());
+            } else if (n >= NTT_THRESHOLD) {
+                return nttMultiply(longer, shorter);
+            } else if (m > 2 * n) {
+                for (size_t offset = 0; offset < m; offset += n) {
+                    addTo(result, multiplyMagnitude(limbRange(longer, offset, offset + n), shorter), offset);
+                }
+            } else if (n >= TOOM3_THRESHOLD) {
+                return toom3Multiply(longer, shorter);
+            } else {
+                Limbs padded = shorter;
+                padded.resize(m, 0);
+                Limbs scratch(karatsubaScratch(m));
+                result.resize(2 * m);
+                karatsubaMultiply(longer.data(), padded.data(), m, result.data(), scratch.data());
+            }
+            trim(result);
+            return result;
+        }
+
+        // a * 2^bits, for bits < 64.
+        static Limbs shiftLeftBits(const Limbs& a, int bits) {
+            Limbs result(a.size() + 1, 0);
+            for (size_t i = 0; i < a.size(); i++) {
+                result[i] |= a[i] << bits;
+                if (bits != 0) result[i + 1] = a[i] >> (64 - bits);
+            }
+            trim(result);
+            return result;
+        }
+
+        // a / 2^bits, for bits < 64.
+        static Limbs shiftRightBits(const Limbs& a, int bits) {
+            Limbs result(a.size(), 0);
+            for (size_t i = 0; i < a.size(); i++) {
+                result[i] = a[i] >> bits;
+                if (bits != 0 && i + 1 < a.size()) result[i] |= a[i + 1] << (64 - bits);
+            }
+            trim(result);
+            return result;
+        }
+
+        // Limbs [from, to) of a, as a number.
+        static Limbs limbRange(const Limbs& a, size_t from, size_t to) {
+            to = std::min(to, a.size());
+            if (from >= to) return Limbs();
+            Limbs result(a.begin() + from, a.begin() + to);
+            trim(result);
+            return result;
+        }
+
+        static size_t bitLength(const Limbs& a) {
+            if (a.empty()) return 0;
+            return a.size() * 64 - __builtin_clzll(a.back());
+        }
+
+        // Knuth's Algorithm D (TAOCP 4.3.1). Both operands are shifted so
+        // the divisor's top limb has its high bit set; each quotient limb is
+        // then estimated from the top two limbs of the remainder, off by at
+        // most two, and corrected before (and rarely after) subtracting its
+        // multiple of the divisor.
+        static std::pair<Limbs, Limbs> longDivide(const Limbs& a, const Limbs& b) {
+            if (compareMagnitude(a, b) < 0) return {Limbs(), a};
+            if (b.size() == 1) {
+                Limbs quotient = a;
+                Limb remainder = divideByLimb(quotient, b[0]);
+                return {std::move(quotient), remainder != 0 ? Limbs{remainder} : Limbs()};
+            }
+
+            int shift = __builtin_clzll(b.back());
+            Limbs v = shiftLeftBits(b, shift);
+            Limbs u = shiftLeftBits(a, shift);
+            size_t n = v.size();
+            size_t m = a.size() - b.size();
+            u.resize(a.size() + 1, 0);
+
+            Limbs quotient(m + 1, 0);
+            for (size_t j = m + 1; j-- > 0;) {
+                Wide numerator = (static_cast<Wide>(u[j + n]) << 64) | u[j + n - 1];
+                Wide estimate = numerator / v[n - 1];
+                Wide rest = numerator % v[n - 1];
+                while ((estimate >> 64) != 0 || estimate * v[n - 2] > ((rest << 64) | u[j + n - 2])) {
+                    estimate--;
+                    rest += v[n - 1];
+                    if ((rest >> 64) != 0) break;
+                }
+
+                Limb digit = static_cast<Limb>(estimate);
+                Limb carry = 0, borrow = 0;
+                for (size_t i = 0; i <= n; i++) {
+                    Limb low = carry;
+                    if (i < n) {
+                        Wide product = static_cast<Wide>(digit) * v[i] + carry;
+                        low = static_cast<Limb>(product);
+                        carry = static_cast<Limb>(product >> 64);
+                    }
+                    Limb diff = u[i + j] - low;
+                    Limb next = (u[i + j] < low) | (diff < borrow);
+                    u[i + j] = diff - borrow;
+                    borrow = next;
+                }
+
+                if (borrow != 0) {
+                    digit--;
+                    Limb add = 0;
+                    for (size_t i = 0; i < n; i++) {
+                        Wide sum = static_cast<Wide>(u[i + j]) + v[i] + add;
+                        u[i + j] = static_cast<Limb>(sum);
+                        add = static_cast<Limb>(sum >> 64);
+                    }
+                    u[j + n] += add;
+                }
+                quotient[j] = digit;
+            }
+
+            trim(quotient);
+            u.resize(n);
+            return {std::move(quotient), shiftRightBits(u, shift)};
+        }
+
+        // Burnikel and Ziegler's recursive division ("Fast Recursive
+        // Division", 1998): a 2n-limb by n-limb division becomes two
+        // 3n/2-by-n steps, each a half-size division plus one multiply, so
+        // large divisions cost a few multiplications. The divisor must have
+        // its high bit set and 'a' be less than b * 2^(64n).
+        static std::pair<Limbs, Limbs> divide2n1n(const Limbs& a, const Limbs& b, size_t n) {
+            if (n % 2 != 0 || n < BURNIKEL_ZIEGLER_THRESHOLD) return longDivide(a, b);
+
+            size_t half = n / 2;
+            auto [high, rest] = divide3n2n(limbRange(a, half, a.size()), b, half);
+            Limbs middle = shiftLimbs(rest, half);
+            addTo(middle, limbRange(a, 0, half));
+            trim(middle);
+            auto [low, remainder] = divide3n2n(middle, b, half);
+
+            addTo(low, high, half);
+            trim(low);
+            return {std::move(low), std::move(remainder)};
+        }
+
+        static std::pair<Limbs, Limbs> divide3n2n(const Limbs& a, const Limbs& b, size_t half) {
+            Limbs b1 = limbRange(b, half, b.size());
+            Limbs b2 = limbRange(b, 0, half);
+            Limbs a12 = limbRange(a, half, a.size());
+
+            Limbs quotient, rest;
+            if (compareMagnitude(limbRange(a, 2 * half, a.size()), b1) < 0) {
+                std::tie(quotient, rest) = divide2n1n(a12, b1, half);
+            } else {
+                // The top halves are equal, so the quotient is 2^(64 half) - 1.
+                quotient.assign(half, ~Limb(0));
+                rest = std::move(a12);
+                addTo(rest, b1);
+                subtractFrom(rest, shiftLimbs(b1, half));
+            }
+
+            Limbs product = multiplyMagnitude(quotient, b2);
+            Limbs remainder = shiftLimbs(rest, half);
+            addTo(remainder, limbRange(a, 0, half));
+            trim(remainder);
+            while (compareMagnitude(remainder, product) < 0) {
+                addTo(remainder, b);
+                subtractFrom(quotient, Limbs{1});
+            }
+            subtractFrom(remainder, product);
+            return {std::move(quotient), std::move(remainder)};
+        }
+
+        // a * 2^(64 * count).
+        static Limbs shiftLimbs(const Limbs& a, size_t count) {
+            if (a.empty()) return Limbs();
+            Limbs result(count, 0);
+            result.insert(result.end(), a.begin(), a.end());
+            return result;
+        }
+
+        // Pads the divisor to j * 2^k limbs with its high bit set, then
+        // divides the dividend by it n limbs at a time.
+        static std::pair<Limbs, Limbs> burnikelZiegler(const Limbs& a, const Limbs& b) {
+            size_t blocks = 1;
+            while (blocks * BURNIKEL_ZIEGLER_THRESHOLD < b.size()) {
+                blocks *= 2;
+            }
+            size_t n = (b.size() + blocks - 1) / blocks * blocks;
+
+            size_t sigma = n * 64 - bitLength(b);
+            Limbs divisor = shiftLimbs(shiftLeftBits(b, sigma % 64), sigma / 64);
+            Limbs dividend = shiftLimbs(shiftLeftBits(a, sigma % 64), sigma / 64);
+
+            // Enough n-limb blocks that the top one is below the divisor.
+            size_t t = std::max<size_t>((bitLength(dividend) + n * 64) / (n * 64), 2);
+            Limbs quotient, remainder;
+            Limbs z = limbRange(dividend, (t - 2) * n, dividend.size());
+            for (size_t i = t - 1; i-- > 0;) {
+                auto [digits, rest] = divide2n1n(z, divisor, n);
+                addTo(quotient, digits, i * n);
+                remainder = std::move(rest);
+                if (i == 0) break;
+                z = shiftLimbs(remainder, n);
+                addTo(z, limbRange(dividend, (i - 1) * n, i * n));
+                trim(z);
+            }
+
+            trim(quotient);
+            remainder = limbRange(remainder, sigma / 64, remainder.size());
+            return {std::move(quotient), shiftRightBits(remainder, sigma % 64)};
+        }
+
+        static std::pair<Limbs, Limbs> divideMagnitude(const Limbs& a, const Limbs& b) {
+            if (b.size() >= BURNIKEL_ZIEGLER_THRESHOLD && a.size() >= b.size() + BURNIKEL_ZIEGLER_OFFSET)
+                return burnikelZiegler(a, b);
+            return longDivide(a, b);
+        }
+
+        // |num|, which holds even for the most negative int64_t.
+        static uint64_t magnitudeOf(int64_t num) {
+            return num < 0 ? 0 - static_cast<uint64_t>(num) : static_cast<uint64_t>(num);
+        }
+
+    public:
+        BigInt() {}
+        BigInt(const std::string& str) { parseFromString(str); }
+        BigInt(uint8_t digit) : BigInt(static_cast<size_t>(digit)) {}
+        BigInt(size_t num) {
+            if (num != 0) limbs.push_back(num);
+        }
+        BigInt(int num) : BigInt(static_cast<int64_t>(num)) {}
+        BigInt(int64_t num) : isNegative(num < 0) {
+            if (num != 0) limbs.push_back(magnitudeOf(num));
+        }
+
+        void removeLeadingZeros() {
+            trim(limbs);
+            if (limbs.empty()) isNegative = false;
         }
 
         void parseFromString(const std::string& str) {
-            digits.clear();
+            limbs.clear();
             isNegative = false;
 
             size_t start = 0;
@@ -48,27 +678,31 @@ class BigInt {
                 start = 1;
             }
 
-            for (size_t i = str.size(); i > start; i--) {
-                char c = str[i - 1];
-                if (!std::isdigit(c)) throw std::invalid_argument("Invalid digit in BigInt string.");
-                digits.push_back(c - '0');
+            // The first chunk takes the odd digits so the rest are whole.
+            size_t chunk = (str.size() - start) % DECIMAL_DIGITS;
+            if (chunk == 0) chunk = DECIMAL_DIGITS;
+            for (size_t i = start; i < str.size(); i += chunk, chunk = DECIMAL_DIGITS) {
+                Limb value = 0, scale = 1;
+                for (size_t j = i; j < i + chunk; j++) {
+                    char c = str[j];
+                    if (!std::isdigit(c)) throw std::invalid_argument("Invalid digit in BigInt string.");
+                    value = value * 10 + (c - '0');
+                    scale *= 10;
+                }
+                multiplyAdd(limbs, scale, value);
             }
 
             removeLeadingZeros();
         }
 
         bool isZero() const {
-            return digits.size() == 1 && digits[0] == 0;
+            return limbs.empty();
         }
 
         bool isPositive() const {
             return !isNegative;
         }
 
-        int length() const {
-            return digits.size();
-        }
-
         void flipSign() {
             if (!isZero()) isNegative = !isNegative;
         }
@@ -78,62 +712,68 @@ class BigInt {
         }
 
         friend std::ostream& operator<<(std::ostream& out, const BigInt& integer) {
-            if (integer.isNegative)
-                out << "-";
-
-            for (auto it = integer.digits.rbegin(); it != integer.digits.rend(); it++)
-                out << static_cast<int>(*it);
-
-            return out;
+            return out << integer.toString();
         }
 
+        // Peels off 19 decimal digits per division by 10^19.
         std::string toString() const {
             std::string res = isNegative ? "-" : "";
-            for (auto it = digits.rbegin(); it != digits.rend(); it++) {
-                res.push_back(*it + '0');
+            if (isZero()) return res + "0";
+
+            Limbs rest = limbs;
+            std::vector<Limb> chunks;
+            while (!rest.empty()) {
+                chunks.push_back(divideByLimb(rest, DECIMAL_BASE));
+            }
+
+            res += std::to_string(chunks.back());
+            for (size_t i = chunks.size() - 1; i-- > 0;) {
+                std::string chunk = std::to_string(chunks[i]);
+                res.append(DECIMAL_DIGITS - chunk.size(), '0');
+                res += chunk;
             }
             return res;
         }
 
+        size_t hash() const {
+            size_t seed = isNegative;
+            for (Limb limb : limbs) {
+                seed = seed * 31 + std::hash<Limb>{}(limb);
+            }
+            return seed;
+        }
+
         BigInt operator-() const {
             BigInt temp = *this;
             temp.flipSign();
             return temp;
         }
 
-        bool operator>(const BigInt& rhs) const {
+        int compare(const BigInt& rhs) const {
             if (isNegative != rhs.isNegative)
-                return !isNegative;
-
-            bool result = false;
-            if (digits.size() != rhs.digits.size()) {
-                result = digits.size() > rhs.digits.size();
-            } else {
-                for (size_t i = digits.size(); i-- > 0;) {
-                    if (digits[i] != rhs.digits[i]) {
-                        result = digits[i] > rhs.digits[i];
-                        break;
-                    }
-                }
-            }
+                return isNegative ? -1 : 1;
+            int result = compareMagnitude(limbs, rhs.limbs);
+            return isNegative ? -result : result;
+        }
 
-            return isNegative ? !result : result;
+        bool operator>(const BigInt& rhs) const {
+            return compare(rhs) > 0;
         }
 
         bool operator<(const BigInt& rhs) const {
-            return !(*this >= rhs);
+            return compare(rhs) < 0;
         }
 
         bool operator==(const BigInt& rhs) const {
-            return (isNegative == rhs.isNegative) && (digits == rhs.digits);
+            return (isNegative == rhs.isNegative) && (limbs == rhs.limbs);
         }
 
         bool operator>=(const BigInt& rhs) const {
-            return (*this > rhs) || (*this == rhs);
+            return compare(rhs) >= 0;
         }
 
         bool operator<=(const BigInt& rhs) const {
-            return (*this < rhs) || (*this == rhs);
+            return compare(rhs) <= 0;
         }
 
         bool operator!=(const BigInt& rhs) const {
@@ -141,30 +781,18 @@ class BigInt {
         }
 
         BigInt operator+(const BigInt& rhs) const {
-            if (isZero()) return rhs;
-            if (rhs.isZero()) return *this;
-
-            BigInt result;
-            result.digits.clear();
             if (isNegative == rhs.isNegative) {
-                result.isNegative = isNegative;
-                size_t maxlen = std::max(digits.size(), rhs.digits.size());
-                uint8_t carry = 0;
-
-                for (size_t i = 0; i < maxlen || carry; ++i) {
-                    uint8_t lhsDigit = (i < digits.size()) ? digits[i] : 0;
-                    uint8_t rhsDigit = (i < rhs.digits.size()) ? rhs.digits[i] : 0;
-                    uint8_t sum = lhsDigit + rhsDigit + carry;
-                    carry = sum / 10;
-                    result.digits.push_back(sum % 10);
-                }
-
+                BigInt result = *this;
+                addTo(result.limbs, rhs.limbs);
                 result.removeLeadingZeros();
                 return result;
             }
 
-            result = *this - (-rhs);
-            result.isNegative = !isNegative;
+            int order = compareMagnitude(limbs, rhs.limbs);
+            if (order == 0) return BigInt();
+            BigInt result = order > 0 ? *this : rhs;
+            subtractFrom(result.limbs, order > 0 ? rhs.limbs : limbs);
+            result.removeLeadingZeros();
             return result;
         }
 
@@ -185,42 +813,7 @@ class BigInt {
         }
 
         BigInt operator-(const BigInt& rhs) const {
-            if (isZero()) return -rhs;
-            if (rhs.isZero()) return *this;
-
-            if (isNegative != rhs.isNegative) return *this + (-rhs);
-
-            BigInt a = *this;
-            BigInt b = rhs;
-            a.isNegative = b.isNegative = false;
-
-            if (a < b) {
-                BigInt result = b - a;
-                result.isNegative = !isNegative;
-                return result;
-            } else {
-                BigInt result;
-                result.digits.clear();
-                uint8_t borrow = 0;
-
-                for (size_t i = 0; i < a.digits.size(); ++i) {
-                    int lhsDigit = a.digits[i] - borrow;
-                    int rhsDigit = (i < b.digits.size()) ? b.digits[i] : 0;
-
-                    if (lhsDigit < rhsDigit) {
-                        lhsDigit += 10;
-                        borrow = 1;
-                    } else {
-                        borrow = 0;
-                    }
-
-                    result.digits.push_back(lhsDigit - rhsDigit);
-                }
-
-                result.removeLeadingZeros();
-                result.isNegative = isNegative;
-                return result;
-            }
+            return *this + (-rhs);
         }
 
         BigInt operator-=(const BigInt& rhs) {
@@ -239,65 +832,9 @@ class BigInt {
             return temp;
         }
 
-        std::pair<BigInt, BigInt> splitAt(size_t index) const {
-            BigInt high, low;
-            low.digits.assign(digits.begin(), digits.begin() + std::min(index, digits.size()));
-            if (index < digits.size())
-                high.digits.assign(digits.begin() + index, digits.end());
-            high.removeLeadingZeros();
-            low.removeLeadingZeros();
-            return {high, low};
-        }
-
-        BigInt shiftLeft(size_t index) const {
-            if(isZero()) return BigInt("0");
-            BigInt res = *this;
-            res.digits.insert(res.digits.begin(),index,0);
-            return res;
-        }
-
-        BigInt naiveMultiply(const BigInt& rhs) const {
-            BigInt result;
-            result.digits = std::vector<uint8_t>(digits.size() + rhs.digits.size(), 0);
-
-            for (size_t i = 0; i < digits.size(); ++i) {
-                int carry = 0;
-                for (size_t j = 0; j < rhs.digits.size(); ++j) {
-                    int prod = digits[i] * rhs.digits[j] + result.digits[i + j] + carry;
-                    result.digits[i + j] = prod % 10;
-                    carry = prod / 10;
-                }
-                if (carry > 0) result.digits[i + rhs.digits.size()] += carry;
-            }
-
-            result.removeLeadingZeros();
-            return result;
-        }
-
-        BigInt karatsubaMultiply(const BigInt& rhs) const {
-            size_t n = std::max(digits.size(),rhs.digits.size());
-            if(n<=32) return naiveMultiply(rhs);
-
-            size_t m = n/2;
-
-            auto [a1,a0] = this->splitAt(m);
-            auto [b1,b0] = rhs.splitAt(m);
-
-            BigInt z0 = a0.karatsubaMultiply(b0);
-            BigInt z2 = a1.karatsubaMultiply(b1);
-            BigInt z1 = (a0+a1).karatsubaMultiply(b0+b1) - z2 - z0;
-
-            BigInt result = (z2.shiftLeft(2*m)) + (z1.shiftLeft(m)) + z0;
-            return result;
-        }
-
         BigInt operator*(const BigInt& rhs) const {
-            if(isZero() || rhs.isZero()) return BigInt("0");
-
-            BigInt result = karatsubaMultiply(rhs);
-            result.isNegative = (isNegative != rhs.isNegative);
-            result.removeLeadingZeros();
-            return result;
+            if(isZero() || rhs.isZero()) return BigInt();
+            return BigInt(multiplyMagnitude(limbs, rhs.limbs), isNegative != rhs.isNegative);
         }
 
         BigInt operator*=(const BigInt& rhs){
@@ -305,42 +842,17 @@ class BigInt {
             return *this;
         }
 
+        // The quotient and remainder of the magnitudes.
         std::pair<BigInt, BigInt> divmod(const BigInt& rhs) const {
-            BigInt quotient, remainder;
-            quotient.digits.resize(digits.size(), 0);
-            for (int i = digits.size() - 1; i >= 0; i--) {
-                remainder.digits.insert(remainder.digits.begin(), digits[i]);
-                remainder.removeLeadingZeros();
-
-                uint8_t low = 0, high = 9, qtDigit = 0;
-                while (low <= high) {
-                    uint8_t mid = (low + high) / 2;
-                    BigInt trial = rhs * BigInt(mid);
-                    if (trial <= remainder) {
-                        qtDigit = mid;
-                        low = mid + 1;
-                    } else {
-                        high = mid - 1;
-                    }
-                }
-
-                quotient.digits[i] = qtDigit;
-                remainder -= rhs * BigInt(qtDigit);
-            }
-
-            quotient.removeLeadingZeros();
-            remainder.removeLeadingZeros();
-            return {quotient, remainder};
+            if(rhs.isZero()) throw std::runtime_error("Division by zero attempted.");
+            auto [quotient, remainder] = divideMagnitude(limbs, rhs.limbs);
+            return {BigInt(std::move(quotient), false), BigInt(std::move(remainder), false)};
         }
 
         BigInt operator/(const BigInt& rhs) const {
             if(rhs.isZero()) throw std::runtime_error("Division by zero attempted.");
-            if(isZero()) return BigInt("0");
-            if(this->abs() < rhs.abs()) return BigInt("0");
-
-            auto [quotient,_] = this->abs().divmod(rhs.abs());
-            quotient.isNegative = isNegative != rhs.isNegative;
-            return quotient;
+            auto [quotient, _] = divideMagnitude(limbs, rhs.limbs);
+            return BigInt(std::move(quotient), isNegative != rhs.isNegative);
         }
 
         BigInt operator/=(const BigInt& rhs){
@@ -348,13 +860,12 @@ class BigInt {
             return *this;
         }
 
+        // Truncating, like the machine-word remainder: the result takes the
+        // sign of the dividend.
         BigInt operator%(const BigInt& rhs) const {
             if(rhs.isZero()) throw std::runtime_error("Modulo by zero attempted.");
-            if(isZero()) return BigInt("0");
-            if(this->abs() < rhs.abs()) return *this;
-
-            auto [_,remainder] = this->abs().divmod(rhs.abs());
-            return remainder;
+            auto [_, remainder] = divideMagnitude(limbs, rhs.limbs);
+            return BigInt(std::move(remainder), isNegative);
         }
 
         BigInt operator%=(const BigInt& rhs){
@@ -382,7 +893,7 @@ class BigInt {
             BigInt result(1);
 
             while (!exponent.isZero()) {
-                if (exponent.digits[0] % 2 != 0) result *= base;
+                if (exponent.isOdd()) result *= base;
                 base *= base;
                 exponent = exponent / BigInt(2);
             }
@@ -392,8 +903,8 @@ class BigInt {
 
         BigInt gcd(const BigInt& rhs) const {
             BigInt a,b;
-            a = *this;
-            b = rhs;
+            a = this->abs();
+            b = rhs.abs();
 
             while(!a.isZero()){
                 BigInt temp = a;
@@ -419,11 +930,11 @@ class BigInt {
         }
 
         bool isEven() const {
-            return digits[0] % 2 == 0;
+            return isZero() || limbs[0] % 2 == 0;
         }
 
         bool isOdd() const {
-            return digits[0] % 2 != 0;
+            return !isEven();
         }
 
         BigInt integerSqrt() const {
@@ -453,17 +964,15 @@ class BigInt {
         }
 
         bool fitsInInt() const {
-            BigInt int64Min(std::numeric_limits<int>::min());
-            BigInt int64Max(std::numeric_limits<int>::max());
-
-            return *this >= int64Min && *this <= int64Max;
+            if (!fitsInInt64()) return false;
+            int64_t value = toInt64();
+            return value >= std::numeric_limits<int>::min() && value <= std::numeric_limits<int>::max();
         }
 
         bool fitsInInt64() const {
-            BigInt int64Min(std::numeric_limits<int64_t>::min());
-            BigInt int64Max(std::numeric_limits<int64_t>::max());
-
-            return *this >= int64Min && *this <= int64Max;
+            if (limbs.size() > 1) return false;
+            if (limbs.empty()) return true;
+            return limbs[0] <= magnitudeOf(isNegative ? std::numeric_limits<int64_t>::min() : std::numeric_limits<int64_t>::max());
         }
 
         int toInt() const {
@@ -475,30 +984,15 @@ class BigInt {
         }
 
         int64_t toInt64() const {
-            int64_t value = 0;
-            for (auto it = digits.rbegin(); it != digits.rend(); ++it) {
-                value = value * 10 + *it;
-            }
-            return isNegative ? -value : value;
+            uint64_t value = limbs.empty() ? 0 : limbs[0];
+            return static_cast<int64_t>(isNegative ? 0 - value : value);
         }
 
         double toDecimal() const {
-            if (*this == BigInt(0)) return 0.0;
-
-            const size_t MAX_DIGITS = 17;
             double result = 0.0;
-
-            size_t len = digits.size();
-            size_t i = 0;
-
-            while (i < std::min(len, MAX_DIGITS)) {
-                result = result * 10 + digits[i];
-                ++i;
+            for (size_t i = limbs.size(); i-- > 0;) {
+                result = std::ldexp(result, 64) + static_cast<double>(limbs[i]);
             }
-
-            int exponent = static_cast<int>(len - i);
-            result *= std::pow(10.0, exponent);
-
             return isNegative ? -result : result;
         }
 
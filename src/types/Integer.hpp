@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
@@ -14,23 +15,62 @@ class Integer {
     private:
         std::variant<int, int64_t, BigInt> value;
 
-        Integer toInteger(const BigInt& num) const {
-            if (num.fitsInInt()) {
-                return Integer(num.toInt());
-            } else if (num.fitsInInt64()) {
-                return Integer(num.toInt64());
-            } else {
-                return Integer(num);
+        static bool inIntRange(int64_t num) {
+            return num >= std::numeric_limits<int>::min() && num <= std::numeric_limits<int>::max();
+        }
+
+        // The value as a machine word, when it is not a BigInt.
+        int64_t word() const {
+            if (std::holds_alternative<int>(value)) return std::get<int>(value);
+            return std::get<int64_t>(value);
+        }
+
+        // <0, 0 or >0 as *this is less than, equal to or greater than rhs.
+        // Values are always held in the narrowest alternative that fits, so
+        // a BigInt lies beyond every machine word and only its sign matters.
+        int compare(const Integer& rhs) const {
+            bool big = std::holds_alternative<BigInt>(value);
+            bool rhsBig = std::holds_alternative<BigInt>(rhs.value);
+            if (!big && !rhsBig) {
+                int64_t lhsWord = word(), rhsWord = rhs.word();
+                return (lhsWord > rhsWord) - (lhsWord < rhsWord);
             }
+            if (!rhsBig) return std::get<BigInt>(value).isPositive() ? 1 : -1;
+            if (!big) return std::get<BigInt>(rhs.value).isPositive() ? -1 : 1;
+
+            return std::get<BigInt>(value).compare(std::get<BigInt>(rhs.value));
+        }
+
+        static Integer negate(int num) {
+            if (num == std::numeric_limits<int>::min())
+                return Integer(-static_cast<int64_t>(num));
+            return Integer(-num);
+        }
+
+        static Integer negate(int64_t num) {
+            if (num == std::numeric_limits<int64_t>::min())
+                return Integer(-BigInt(num));
+            return Integer(-num);
         }
 
     public:
         Integer() : value(0) {}
         Integer(bool v) : value(static_cast<int>(v)) {}
         Integer(int v) : value(v) {}
-        Integer(int64_t v) : value(v) {}
-        Integer(const BigInt& v) : value(v) {}
-        Integer(BigInt&& v) : value(std::move(v)) {}
+        Integer(int64_t v) {
+            if (inIntRange(v)) value = static_cast<int>(v);
+            else value = v;
+        }
+
+        Integer(const BigInt& v) {
+            if (v.fitsInInt64()) *this = Integer(v.toInt64());
+            else value = v;
+        }
+
+        Integer(BigInt&& v) {
+            if (v.fitsInInt64()) *this = Integer(v.toInt64());
+            else value = std::move(v);
+        }
         Integer(double v);
         Integer(BigDecimal v);
 
@@ -77,7 +117,7 @@ class Integer {
                 if constexpr (std::is_same_v<T, BigInt>) {
                     return arg.abs();
                 } else {
-                    return arg < 0 ? -arg : arg;
+                    return arg < 0 ? negate(arg) : Integer(arg);
                 }
             }, value);
         }
@@ -91,75 +131,81 @@ class Integer {
 
         Integer operator-() const {
             if (std::holds_alternative<int>(value))
-                return Integer(-std::get<int>(value));
+                return negate(std::get<int>(value));
             if (std::holds_alternative<int64_t>(value))
-                return Integer(-std::get<int64_t>(value));
+                return negate(std::get<int64_t>(value));
             BigInt tmp = std::get<BigInt>(value);
             tmp.setSign(tmp.isPositive());
             return Integer(tmp);
         }
 
         bool operator==(const Integer& rhs) const {
-            return value == rhs.value;
+            return compare(rhs) == 0;
         }
 
         bool operator!=(const Integer& rhs) const {
-            return value != rhs.value;
+            return compare(rhs) != 0;
         }
 
         bool operator>(const Integer& rhs) const {
-            return value > rhs.value;
+            return compare(rhs) > 0;
         }
 
         bool operator<(const Integer& rhs) const {
-            return value < rhs.value;
+            return compare(rhs) < 0;
         }
 
         bool operator>=(const Integer& rhs) const {
-            return value >= rhs.value;
+            return compare(rhs) >= 0;
         }
 
         bool operator<=(const Integer& rhs) const {
-            return value <= rhs.value;
+            return compare(rhs) <= 0;
+        }
+
+        // Equal values hash alike whatever their width.
+        size_t hash() const {
+            if (std::holds_alternative<BigInt>(value)) return std::get<BigInt>(value).hash();
+            return std::hash<int64_t>{}(word());
         }
 
         Integer add(BigInt lhs, BigInt rhs) const {
             BigInt res = lhs + rhs;
-            return toInteger(res);
+            return Integer(res);
         }
 
         Integer add(BigInt lhs, int64_t rhs) const {
             BigInt res = lhs + BigInt(rhs);
-            return toInteger(res);
+            return Integer(res);
         }
 
         Integer add(int64_t lhs, BigInt rhs) const {
             BigInt res = BigInt(lhs) + rhs;
-            return toInteger(res);
+            return Integer(res);
         }
 
         Integer add(BigInt lhs, int rhs) const {
             BigInt res = lhs + BigInt(rhs);
-            return toInteger(res);
+            return Integer(res);
         }
 
         Integer add(int lhs, BigInt rhs) const {
             BigInt res = BigInt(lhs) + rhs;
-            return toInteger(res);
+            return Integer(res);
         }
 
         Integer add(int lhs, int rhs) const {
-            int64_t result = static_cast<int64_t>(lhs) + static_cast<int64_t>(rhs);
-            if (result > std::numeric_limits<int>::max() || result < std::numeric_limits<int>::min())
-                return Integer(static_cast<int64_t>(result));
-            return Integer(static_cast<int>(result));
+            int result;
+            if (!__builtin_add_overflow(lhs, rhs, &result))
+                return Integer(result);
+            return Integer(static_cast<int64_t>(lhs) + rhs);
         }
 
         Integer add(int64_t lhs, int64_t rhs) const {
-            BigInt res = BigInt(lhs) + BigInt(rhs);
-            if (res.fitsInInt64())
-                return Integer(res.toInt64());
-            return Integer(res);
+            int64_t result;
+            if (!__builtin_add_overflow(lhs, rhs, &result))
+                return Integer(result);
+            return Integer(BigInt(lhs) + BigInt(rhs));
         }
 
         Integer add(int64_t lhs, int rhs) const {
@@ -196,41 +242,41 @@ class Integer {
 
         Integer subtract(BigInt lhs, BigInt rhs) const {
             BigInt res = lhs - rhs;
-            return toInteger(res);
+            return Integer(res);
         }
 
         Integer subtract(BigInt lhs, int64_t rhs) const {
             BigInt res = lhs - BigInt(rhs);
-            return toInteger(res);
+            return Integer(res);
         }
 
         Integer subtract(int64_t lhs, BigInt rhs) const {
             BigInt res = BigInt(lhs) - rhs;
-            return toInteger(res);
+            return Integer(res);
         }
 
         Integer subtract(BigInt lhs, int rhs) const {
             BigInt res = lhs - BigInt(rhs);
-            return toInteger(res);
+            return Integer(res);
         }
 
         Integer subtract(int lhs, BigInt rhs) const {
             BigInt res = BigInt(lhs) - rhs;
-            return toInteger(res);
+            return Integer(res);
         }
 
         Integer subtract(int lhs, int rhs) const {
-            int64_t result = static_cast<int64_t>(lhs) - static_cast<int64_t>(rhs);
-            if (result > std::numeric_limits<int>::max() || result < std::numeric_limits<int>::min())
-                return Integer(static_cast<int64_t>(result));
-            return Integer(static_cast<int>(result));
+            int result;
+            if (!__builtin_sub_overflow(lhs, rhs, &result))
+                return Integer(result);
+            return Integer(static_cast<int64_t>(lhs) - rhs);
         }
 
         Integer subtract(int64_t lhs, int64_t rhs) const {
-            BigInt res = BigInt(lhs) - BigInt(rhs);
-            if (res.fitsInInt64())
-                return Integer(res.toInt64());
-            return Integer(res);
+            int64_t result;
+            if (!__builtin_sub_overflow(lhs, rhs, &result))
+                return Integer(result);
+            return Integer(BigInt(lhs) - BigInt(rhs));
         }
 
         Integer subtract(int64_t lhs, int rhs) const {
@@ -267,41 +313,41 @@ class Integer {
 
         Integer multiply(BigInt lhs, BigInt rhs) const {
             BigInt res = lhs * rhs;
-            return res;
+            return Integer(res);
         }
 
         Integer multiply(BigInt lhs, int64_t rhs) const {
             BigInt res = lhs * BigInt(rhs);
-            return res;
+            return Integer(res);
         }
 
         Integer multiply(int64_t lhs, BigInt rhs) const {
             BigInt res = BigInt(lhs) * rhs;
-            return res;
+            return Integer(res);
         }
 
         Integer multiply(BigInt lhs, int rhs) const {
             BigInt res = lhs * BigInt(rhs);
-            return res;
+            return Integer(res);
         }
 
         Integer multiply(int lhs, BigInt rhs) const {
             BigInt res = BigInt(lhs) * rhs;
-            return res;
+            return Integer(res);
         }
 
         Integer multiply(int lhs, int rhs) const {
-            int64_t result = static_cast<int64_t>(lhs) * static_cast<int64_t>(rhs);
-            if (result > std::numeric_limits<int>::max() || result < std::numeric_limits<int>::min())
-                return Integer(static_cast<int64_t>(result));
-            return Integer(static_cast<int>(result));
+            int result;
+            if (!__builtin_mul_overflow(lhs, rhs, &result))
+                return Integer(result);
+            return Integer(static_cast<int64_t>(lhs) * rhs);
         }
 
         Integer multiply(int64_t lhs, int64_t rhs) const {
-            BigInt res = BigInt(lhs) * BigInt(rhs);
-            if (res.fitsInInt64())
-                return Integer(res.toInt64());
-            return Integer(res);
+            int64_t result;
+            if (!__builtin_mul_overflow(lhs, rhs, &result))
+                return Integer(result);
+            return Integer(BigInt(lhs) * BigInt(rhs));
         }
 
         Integer multiply(int64_t lhs, int rhs) const {
@@ -327,41 +373,40 @@ class Integer {
 
         Integer divide(BigInt lhs, BigInt rhs) const {
             BigInt res = lhs / rhs;
-            return toInteger(res);
+            return Integer(res);
         }
 
         Integer divide(BigInt lhs, int64_t rhs) const {
             BigInt res = lhs / BigInt(rhs);
-            return toInteger(res);
+            return Integer(res);
         }
 
         Integer divide(int64_t lhs, BigInt rhs) const {
             BigInt res = BigInt(lhs) / rhs;
-            return toInteger(res);
+            return Integer(res);
         }
 
         Integer divide(BigInt lhs, int rhs) const {
             BigInt res = lhs / BigInt(rhs);
-            return toInteger(res);
+            return Integer(res);
         }
 
         Integer divide(int lhs, BigInt rhs) const {
             BigInt res = BigInt(lhs) / rhs;
-            return toInteger(res);
+            return Integer(res);
         }
 
+        // Only the most negative value divided by -1 overflows.
         Integer divide(int lhs, int rhs) const {
-            int64_t result = static_cast<int64_t>(lhs) / static_cast<int64_t>(rhs);
-            if (result > std::numeric_limits<int>::max() || result < std::numeric_limits<int>::min())
-                return Integer(static_cast<int64_t>(result));
-            return Integer(static_cast<int>(result));
+            if (rhs == -1)
+                return negate(lhs);
+            return Integer(lhs / rhs);
         }
 
         Integer divide(int64_t lhs, int64_t rhs) const {
-            BigInt res = BigInt(lhs) / BigInt(rhs);
-            if (res.fitsInInt64())
-                return Integer(res.toInt64());
-            return Integer(res);
+            if (rhs == -1)
+                return negate(lhs);
+            return Integer(lhs / rhs);
         }
 
         Integer divide(int64_t lhs, int rhs) const {
@@ -389,41 +434,39 @@ class Integer {
 
         Integer modulus(BigInt lhs, BigInt rhs) const {
             BigInt res = lhs % rhs;
-            return toInteger(res);
+            return Integer(res);
         }
 
         Integer modulus(BigInt lhs, int64_t rhs) const {
             BigInt res = lhs % BigInt(rhs);
-            return toInteger(res);
+            return Integer(res);
         }
 
         Integer modulus(int64_t lhs, BigInt rhs) const {
             BigInt res = BigInt(lhs) % rhs;
-            return toInteger(res);
+            return Integer(res);
         }
 
         Integer modulus(BigInt lhs, int rhs) const {
             BigInt res = lhs % BigInt(rhs);
-            return toInteger(res);
+            return Integer(res);
         }
 
         Integer modulus(int lhs, BigInt rhs) const {
             BigInt res = BigInt(lhs) % rhs;
-            return toInteger(res);
+            return Integer(res);
         }
 
         Integer modulus(int lhs, int rhs) const {
-            int64_t result = static_cast<int64_t>(lhs) % static_cast<int64_t>(rhs);
-            if (result > std::numeric_limits<int>::max() || result < std::numeric_limits<int>::min())
-                return Integer(static_cast<int64_t>(result));
-            return Integer(static_cast<int>(result));
+            if (rhs == -1)
+                return Integer(0);
+            return Integer(lhs % rhs);
         }
 
         Integer modulus(int64_t lhs, int64_t rhs) const {
-            BigInt res = BigInt(lhs) % BigInt(rhs);
-            if (res.fitsInInt64())
-                return Integer(res.toInt64());
-            return Integer(res);
+            if (rhs == -1)
+                return Integer(0);
+            return Integer(lhs % rhs);
         }
 
         Integer modulus(int64_t lhs, int rhs) const {
@@ -464,5 +507,13 @@ class Integer {
             return true;
         }
 
+        bool fitsInInt() const {
+            return std::holds_alternative<int>(value);
+        }
+
+        int toInt() const {
+            return std::get<int>(value);
+        }
+
         BigDecimal toBigDecimal() const;
 };
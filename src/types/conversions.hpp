@@ -1,3 +1,5 @@
+#pragma once
+
 #include "BigInt.hpp"
 #include "BigDecimal.hpp"
 #include "Integer.hpp"
@@ -34,17 +36,17 @@ BigDecimal intToDecimal(BigInt integer, size_t decimalPointPos) {
 }
 
 Integer::Integer(double v) {
-    if (v >= static_cast<double>(INT32_MIN) && v <= static_cast<double>(INT32_MAX)) {
+    if (v > static_cast<double>(INT32_MIN) - 1 && v < static_cast<double>(INT32_MAX) + 1) {
         value = static_cast<int>(v);
-    } else if (v >= static_cast<double>(INT64_MIN) && v <= static_cast<double>(INT64_MAX)) {
+    } else if (v >= static_cast<double>(INT64_MIN) && v < static_cast<double>(INT64_MAX)) {
         value = static_cast<int64_t>(v);
     } else {
         BigDecimal bd(v);
-        value = bd.truncate();
+        *this = Integer(bd.truncate());
     }
 }
 
-Integer::Integer(BigDecimal v) : value(v.truncate()) {}
+Integer::Integer(BigDecimal v) : Integer(v.truncate()) {}
 
 
 BigDecimal Integer::toBigDecimal() const {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "types/conversions.hpp"
+#include "value.hpp"
 #include <memory>
 #include <optional>
 #include <variant>
@@ -15,22 +16,12 @@
 #define ORANGE  "\033[38;5;208m"
 #define RESET   "\033[0m"
 
-class Callable;
-class Inst;
-using CallAble = std::shared_ptr<Callable>;
-using Instance = std::shared_ptr<Inst>;
-
-template <typename T, typename... Args>
-std::shared_ptr<T> makeShared(Args&&... args) {
-	return std::make_shared<T>(std::forward<Args>(args)...);
-}
-
 using LiteralCore = std::variant<Integer,double,BigDecimal,std::string,bool,Nil>;
 using LiteralType = std::optional<LiteralCore>;
 using LiteralValue = std::pair<LiteralCore,std::string>;
-using RuntimeValue = std::variant<LiteralValue,CallAble,Instance,std::nullptr_t>;
+using RuntimeValue = Value;
 
-#define _NIL LiteralValue{Nil(),"nil"}
+#define _NIL Value()
 
 LiteralValue getLiteralData(const LiteralType& expr) {
     LiteralValue result;
@@ -57,15 +48,8 @@ LiteralValue getLiteralData(const LiteralType& expr) {
     return result;
 }
 
-LiteralValue getLiteralValue(const RuntimeValue& val) {
-    if(std::holds_alternative<LiteralValue>(val))
-        return std::get<LiteralValue>(val);
-    else 
-        return _NIL;
-}
-
-bool isNil(const LiteralCore& val) {
-    return std::holds_alternative<Nil>(val);
+RuntimeValue toRuntimeValue(const LiteralCore& literal) {
+    return std::visit([](const auto& val) { return RuntimeValue(val); }, literal);
 }
 
 std::string cleanDouble(double val, int precision = 12) {
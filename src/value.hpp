@@ -0,0 +1,250 @@
+#pragma once
+
+#include "typeTag.hpp"
+#include "types/conversions.hpp"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+class Callable;
+class Inst;
+
+// Base of every heap allocated runtime value. Values and Refs share one
+// intrusive count, so an object can move between them freely.
+class Obj {
+    public:
+        TypeTag type;
+        mutable uint32_t refCount = 0;
+
+        Obj(TypeTag type) : type(type) {}
+        Obj(const Obj& other) : type(other.type) {}
+        Obj& operator=(const Obj&) { return *this; }
+        virtual ~Obj() = default;
+};
+
+template <typename T>
+class Ref {
+    private:
+        T* ptr = nullptr;
+
+        void retain() const {
+            if(ptr != nullptr) static_cast<const Obj*>(ptr)->refCount++;
+        }
+
+        void release() {
+            if(ptr != nullptr && --static_cast<const Obj*>(ptr)->refCount == 0) {
+                delete static_cast<Obj*>(ptr);
+            }
+        }
+
+    public:
+        Ref() {}
+        Ref(std::nullptr_t) {}
+        Ref(T* ptr) : ptr(ptr) { retain(); }
+        Ref(const Ref& other) : ptr(other.ptr) { retain(); }
+        Ref(Ref&& other) noexcept : ptr(other.ptr) { other.ptr = nullptr; }
+
+        template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+        Ref(const Ref<U>& other) : ptr(other.get()) { retain(); }
+
+        ~Ref() { release(); }
+
+        Ref& operator=(Ref other) {
+            std::swap(ptr, other.ptr);
+            return *this;
+        }
+
+        T* get() const { return ptr; }
+        T* operator->() const { return ptr; }
+        T& operator*() const { return *ptr; }
+        explicit operator bool() const { return ptr != nullptr; }
+
+        bool operator==(const Ref& other) const { return ptr == other.ptr; }
+        bool operator==(std::nullptr_t) const { return ptr == nullptr; }
+};
+
+template <typename T, typename... Args>
+Ref<T> makeRef(Args&&... args) {
+    return Ref<T>(new T(std::forward<Args>(args)...));
+}
+
+template <typename T, typename U>
+Ref<T> refCast(const Ref<U>& ref) {
+    return Ref<T>(dynamic_cast<T*>(ref.get()));
+}
+
+using CallAble = Ref<Callable>;
+using Instance = Ref<Inst>;
+
+class StringObj : public Obj {
+    public:
+        std::string value;
+
+        StringObj(std::string value,TypeTag type = TypeTag::STRING) : Obj(type), value(std::move(value)) {}
+};
+
+class IntegerObj : public Obj {
+    public:
+        Integer value;
+
+        IntegerObj(Integer value) : Obj(TypeTag::INTEGER), value(std::move(value)) {}
+};
+
+class BigDecimalObj : public Obj {
+    public:
+        BigDecimal value;
+
+        BigDecimalObj(BigDecimal value) : Obj(TypeTag::BIG_DECIMAL), value(std::move(value)) {}
+};
+
+// A runtime value packed into one 64-bit word (NaN boxing).
+//
+//   double       any bit pattern that is not a quiet NaN with bits 50..62 set
+//   nil/bool     QNAN | 1, 2, 3
+//   small int    QNAN | INT_TAG | 32-bit payload
+//   object       SIGN | QNAN | 48-bit pointer
+//
+// Immediates never allocate; strings, large integers, BigDecimals, callables
+// and instances live on the heap behind a refcounted Obj.
+class Value {
+    private:
+        static constexpr uint64_t SIGN_BIT = 0x8000000000000000;
+        static constexpr uint64_t QNAN = 0x7ffc000000000000;
+        static constexpr uint64_t INT_TAG = 0x0001000000000000;
+        static constexpr uint64_t NIL_BITS = QNAN | 1;
+        static constexpr uint64_t FALSE_BITS = QNAN | 2;
+        static constexpr uint64_t TRUE_BITS = QNAN | 3;
+        static constexpr uint64_t CANONICAL_NAN = 0x7ff8000000000000;
+
+        uint64_t bits;
+
+        Obj* obj() const {
+            return reinterpret_cast<Obj*>(bits & ~(SIGN_BIT | QNAN));
+        }
+
+        void retain() const {
+            if(isObj()) obj()->refCount++;
+        }
+
+        void release() {
+            if(isObj() && --obj()->refCount == 0) delete obj();
+        }
+
+        void setObj(Obj* object) {
+            if(object == nullptr) {
+                bits = NIL_BITS;
+                return;
+            }
+            bits = SIGN_BIT | QNAN | reinterpret_cast<uint64_t>(object);
+            object->refCount++;
+        }
+
+        bool isObjType(TypeTag type) const {
+            return isObj() && obj()->type == type;
+        }
+
+    public:
+        Value() : bits(NIL_BITS) {}
+        Value(std::nullptr_t) : bits(NIL_BITS) {}
+        Value(Nil) : bits(NIL_BITS) {}
+        Value(bool value) : bits(value ? TRUE_BITS : FALSE_BITS) {}
+        Value(int value) : bits(QNAN | INT_TAG | static_cast<uint32_t>(value)) {}
+
+        Value(double value) {
+            if(value != value) {
+                bits = CANONICAL_NAN;
+                return;
+            }
+            std::memcpy(&bits, &value, sizeof(double));
+        }
+
+        Value(const Integer& value) {
+            if(value.fitsInInt()) bits = QNAN | INT_TAG | static_cast<uint32_t>(value.toInt());
+            else setObj(new IntegerObj(value));
+        }
+
+        Value(const BigDecimal& value) { setObj(new BigDecimalObj(value)); }
+        Value(std::string value) { setObj(new StringObj(std::move(value))); }
+        Value(const char* value) { setObj(new StringObj(value)); }
+
+        template <typename T>
+        Value(const Ref<T>& ref) { setObj(ref.get()); }
+
+        Value(const Value& other) : bits(other.bits) { retain(); }
+        Value(Value&& other) noexcept : bits(other.bits) { other.bits = NIL_BITS; }
+        ~Value() { release(); }
+
+        Value& operator=(const Value& other) {
+            other.retain();
+            release();
+            bits = other.bits;
+            return *this;
+        }
+
+        Value& operator=(Value&& other) noexcept {
+            if(this != &other) {
+                release();
+                bits = other.bits;
+                other.bits = NIL_BITS;
+            }
+            return *this;
+        }
+
+        // The result of typeOf(): printed as <name>.
+        static Value ofType(std::string name) {
+            Value value;
+            value.setObj(new StringObj(std::move(name),TypeTag::TYPE));
+            return value;
+        }
+
+        bool isNil() const { return bits == NIL_BITS; }
+        bool isBool() const { return (bits | 1) == TRUE_BITS; }
+        bool isDecimal() const { return (bits & QNAN) != QNAN; }
+        bool isSmallInt() const { return (bits & (SIGN_BIT | QNAN | INT_TAG)) == (QNAN | INT_TAG); }
+        bool isObj() const { return (bits & (SIGN_BIT | QNAN)) == (SIGN_BIT | QNAN); }
+        bool isInteger() const { return isSmallInt() || isObjType(TypeTag::INTEGER); }
+        bool isBigDecimal() const { return isObjType(TypeTag::BIG_DECIMAL); }
+        bool isString() const { return isObjType(TypeTag::STRING); }
+        bool isTypeName() const { return isObjType(TypeTag::TYPE); }
+        bool isCallable() const { return isObjType(TypeTag::FUNCTION) || isObjType(TypeTag::CLASS); }
+        bool isInstance() const { return isObjType(TypeTag::INSTANCE); }
+
+        bool asBool() const { return bits == TRUE_BITS; }
+        int asSmallInt() const { return static_cast<int32_t>(static_cast<uint32_t>(bits)); }
+
+        double asDecimal() const {
+            double value;
+            std::memcpy(&value, &bits, sizeof(double));
+            return value;
+        }
+
+        Integer asInteger() const {
+            if(isSmallInt()) return Integer(asSmallInt());
+            return static_cast<IntegerObj*>(obj())->value;
+        }
+
+        const BigDecimal& asBigDecimal() const { return static_cast<BigDecimalObj*>(obj())->value; }
+        const std::string& asString() const { return static_cast<StringObj*>(obj())->value; }
+
+        Obj* object() const { return isObj() ? obj() : nullptr; }
+
+        CallAble asCallable() const;
+        Instance asInstance() const;
+
+        template <typename T>
+        decltype(auto) as() const {
+            if constexpr (std::is_same_v<T, bool>) return asBool();
+            else if constexpr (std::is_same_v<T, double>) return asDecimal();
+            else if constexpr (std::is_same_v<T, Integer>) return asInteger();
+            else if constexpr (std::is_same_v<T, BigDecimal>) return asBigDecimal();
+            else return asString();
+        }
+
+        TypeTag typeTag() const {
+            if(isDecimal()) return TypeTag::DECIMAL;
+            if(isSmallInt()) return TypeTag::INTEGER;
+            if(isObj()) return obj()->type;
+            return isNil() ? TypeTag::NIL : TypeTag::BOOLEAN;
+        }
+};
@@ -0,0 +1,458 @@
+#pragma once
+
+#include "chunk.hpp"
+#include "class.hpp"
+#include "error.hpp"
+#include "function.hpp"
+#include "instance.hpp"
+#include "interpreter.hpp"
+#include "util.hpp"
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <vector>
+
+class CallFrame {
+    public:
+        const Chunk* chunk;
+        size_t ip;
+        size_t base;
+        // Arena frames acquired by this call are released when it returns.
+        size_t arenaMark;
+        Ref<Environment> previous;
+        Ref<Function> function;
+        // The instance an unbound method runs on, or nil.
+        RuntimeValue receiver;
+};
+
+class VM {
+    private:
+        Interpreter& interpreter;
+        const Program* program = nullptr;
+        std::vector<RuntimeValue> stack;
+        std::vector<CallFrame> frames;
+        // Warnings printed before the invariant expression being evaluated;
+        // these never nest, since they contain no calls.
+        uint64_t invariantWarnings = 0;
+
+        void push(RuntimeValue value) {
+            stack.push_back(std::move(value));
+        }
+
+        RuntimeValue pop() {
+            RuntimeValue value = std::move(stack.back());
+            stack.pop_back();
+            return value;
+        }
+
+        RuntimeValue& peek(size_t distance = 0) {
+            return stack[stack.size() - 1 - distance];
+        }
+
+        std::vector<RuntimeValue> popArguments(int argc) {
+            std::vector<RuntimeValue> args(argc);
+            for(int i = argc - 1; i >= 0; i--) {
+                args[i] = pop();
+            }
+            return args;
+        }
+
+        void callFunction(const Ref<Function>& function,const Token& name,int argc,const RuntimeValue& receiver = _NIL) {
+            if(function->code == nullptr)
+                throw RuntimeError(name,"Function was not compiled for the VM.");
+
+            size_t arenaMark = interpreter.arena.mark();
+            Environment* environment = function->bindArguments(interpreter,name,popArguments(argc),receiver);
+            frames.push_back(CallFrame{function->code,0,stack.size(),arenaMark,interpreter.environment,function,receiver});
+            interpreter.environment = environment;
+        }
+
+        // The receiver sits where CALL expects the callee. A method runs
+        // unbound on it; a field is swapped in and called like any value.
+        void invokeMethod(const Token& method,InlineCache& cache,int argc,const Token& name,const Token& paren,std::optional<TypeTag> argType) {
+            RuntimeValue& receiver = peek(argc);
+            if(!receiver.isInstance()) {
+                throw RuntimeError(method,"Only instances have properties.");
+            }
+
+            Instance instance = receiver.asInstance();
+            InlineCache::Entry entry = instance->lookup(method,cache);
+            if(entry.slot >= 0) {
+                receiver = instance->field(entry.slot);
+                callValue(argc,name,paren,argType);
+                return;
+            }
+
+            int arity = entry.method->arity();
+            if(arity != argc) {
+                throw RuntimeError(paren,"Expected "+std::to_string(arity)+" arguments but got "+std::to_string(argc)+".");
+            }
+            callFunction(Ref<Function>(entry.method),name,argc,receiver);
+        }
+
+        void callValue(int argc,const Token& name,const Token& paren,std::optional<TypeTag> argType) {
+            RuntimeValue& callee = peek(argc);
+            if(!callee.isCallable()) {
+                throw RuntimeError(paren,"Can only call functions and classes.");
+            }
+
+            CallAble callable = callee.asCallable();
+            int arity = callable->arity();
+            if(arity != argc) {
+                throw RuntimeError(paren,"Expected "+std::to_string(arity)+" arguments but got "+std::to_string(argc)+".");
+            }
+
+            if(auto fn = refCast<Function>(callable)) {
+                callFunction(fn,name,argc);
+                return;
+            }
+
+            if(auto klass = refCast<Class>(callable)) {
+                Instance instance = makeRef<Inst>(klass);
+                if(klass->initializer != nullptr) {
+                    callFunction(klass->initializer,name,argc,instance);
+                } else {
+                    stack.pop_back();
+                    push(instance);
+                }
+                return;
+            }
+
+            RuntimeValue result;
+            if(dynamic_cast<TypeOfFunction*>(callable.get())) {
+                result = TypeOfFunction::describe(pop(),argType);
+            } else {
+                result = callable->callValues(interpreter,name,popArguments(argc));
+            }
+            stack.pop_back();
+            push(result);
+        }
+
+        void finishCall(RuntimeValue result) {
+            CallFrame& frame = frames.back();
+            interpreter.environment = frame.previous;
+            interpreter.arena.releaseTo(frame.arenaMark);
+            stack.resize(frame.base - 1);
+            frames.pop_back();
+            push(std::move(result));
+        }
+
+        void run() {
+            CallFrame* frame = &frames.back();
+            const Chunk* chunk = frame->chunk;
+            const uint8_t* code = chunk->code.data();
+            size_t ip = frame->ip;
+
+            auto readByte = [&]() -> uint8_t { return code[ip++]; };
+            auto readShort = [&]() -> uint16_t {
+                uint16_t value = code[ip] | (code[ip + 1] << 8);
+                ip += 2;
+                return value;
+            };
+            auto readToken = [&]() -> const Token& { return chunk->tokens[readShort()]; };
+            auto reload = [&]() {
+                frame = &frames.back();
+                chunk = frame->chunk;
+                code = chunk->code.data();
+                ip = frame->ip;
+            };
+
+            while(true) {
+                switch(static_cast<OpCode>(readByte())) {
+                    case OpCode::CONSTANT:
+                        push(chunk->constants[readShort()]);
+                        break;
+
+                    case OpCode::NIL:
+                        push(_NIL);
+                        break;
+
+                    case OpCode::POP:
+                        stack.pop_back();
+                        break;
+
+                    case OpCode::GET_LOCAL: {
+                        uint16_t depth = readShort();
+                        push(interpreter.environment->getAt(depth,readShort()));
+                        break;
+                    }
+
+                    case OpCode::SET_LOCAL: {
+                        uint16_t depth = readShort();
+                        interpreter.environment->assignAt(depth,readShort(),peek());
+                        break;
+                    }
+
+                    case OpCode::GET_GLOBAL:
+                        push(interpreter.globals->get(readToken()));
+                        break;
+
+                    case OpCode::SET_GLOBAL:
+                        interpreter.globals->assign(readToken(),peek());
+                        break;
+
+                    case OpCode::DEFINE: {
+                        uint16_t slot = readShort();
+                        const Token& name = readToken();
+                        const Token& type = readToken();
+                        interpreter.defineVariable(slot == NO_OPERAND ? -1 : slot,name,pop(),typeTagOf(type.lexeme));
+                        break;
+                    }
+
+                    case OpCode::GET_PROPERTY: {
+                        const Token& name = readToken();
+                        InlineCache& cache = *chunk->caches[readShort()];
+                        RuntimeValue object = pop();
+                        if(!object.isInstance()) {
+                            throw RuntimeError(name,"Only instances have properties.");
+                        }
+                        push(object.asInstance()->get(name,cache));
+                        break;
+                    }
+
+                    case OpCode::SET_PROPERTY: {
+                        const Token& name = readToken();
+                        InlineCache& cache = *chunk->caches[readShort()];
+                        RuntimeValue value = pop();
+                        RuntimeValue object = pop();
+                        if(!object.isInstance()) {
+                            throw RuntimeError(name,"Only instances have fields.");
+                        }
+                        object.asInstance()->set(name,value,cache);
+                        push(value);
+                        break;
+                    }
+
+                    case OpCode::GET_SUPER: {
+                        uint16_t depth = readShort();
+                        const Token& method = readToken();
+                        push(interpreter.lookUpSuper(method,depth,*chunk->caches[readShort()]));
+                        break;
+                    }
+
+                    case OpCode::BINARY: {
+                        const Token& op = readToken();
+                        RuntimeValue right = pop();
+                        RuntimeValue left = pop();
+                        push(interpreter.binaryOp(op,left,right));
+                        break;
+                    }
+
+                    case OpCode::UNARY: {
+                        const Token& op = readToken();
+                        push(interpreter.unaryOp(op,pop()));
+                        break;
+                    }
+
+                    case OpCode::STEP: {
+                        const Token& op = readToken();
+                        StepTarget target = static_cast<StepTarget>(readByte());
+                        RuntimeValue value = pop();
+                        RuntimeValue stepped = interpreter.stepValue(op,value);
+                        if(target != StepTarget::VARIABLE) {
+                            interpreter.stepTargetError(op,target == StepTarget::LITERAL);
+                        }
+                        bool prefix = op.type == TokenType::PRE_INCR || op.type == TokenType::PRE_DECR;
+                        push(prefix ? stepped : value);
+                        push(std::move(stepped));
+                        break;
+                    }
+
+                    case OpCode::TRUTHY:
+                        push(interpreter.isTruthy(pop()));
+                        break;
+
+                    case OpCode::JUMP: {
+                        uint16_t offset = readShort();
+                        ip += offset;
+                        break;
+                    }
+
+                    case OpCode::JUMP_IF_FALSE: {
+                        uint16_t offset = readShort();
+                        if(!interpreter.isTruthy(pop())) ip += offset;
+                        break;
+                    }
+
+                    case OpCode::JUMP_IF_TRUE_KEEP: {
+                        uint16_t offset = readShort();
+                        if(interpreter.isTruthy(peek())) ip += offset;
+                        break;
+                    }
+
+                    case OpCode::JUMP_IF_FALSE_KEEP: {
+                        uint16_t offset = readShort();
+                        if(!interpreter.isTruthy(peek())) ip += offset;
+                        break;
+                    }
+
+                    case OpCode::LOOP: {
+                        uint16_t offset = readShort();
+                        ip -= offset;
+                        Heap::instance().collectIfNeeded();
+                        break;
+                    }
+
+                    case OpCode::PRINT:
+                        std::cout<<interpreter.stringify(pop())<<std::endl;
+                        break;
+
+                    case OpCode::CALL:
+                    case OpCode::INVOKE: {
+                        Heap::instance().collectIfNeeded();
+                        bool invoke = static_cast<OpCode>(code[ip - 1]) == OpCode::INVOKE;
+                        const Token* method = nullptr;
+                        InlineCache* cache = nullptr;
+                        if(invoke) {
+                            method = &readToken();
+                            cache = chunk->caches[readShort()];
+                        }
+                        int argc = readByte();
+                        const Token& name = readToken();
+                        const Token& paren = readToken();
+                        uint16_t argVariable = readShort();
+                        uint16_t argDepth = readShort();
+                        uint16_t argSlot = readShort();
+
+                        std::optional<TypeTag> argType;
+                        if(argVariable != NO_OPERAND) {
+                            argType = argDepth == NO_OPERAND
+                                ? interpreter.globals->getType(chunk->tokens[argVariable])
+                                : interpreter.environment->getTypeAt(argDepth,argSlot);
+                        }
+
+                        frame->ip = ip;
+                        size_t depth = frames.size();
+                        if(invoke) invokeMethod(*method,*cache,argc,name,paren,argType);
+                        else callValue(argc,name,paren,argType);
+                        if(frames.size() != depth) reload();
+                        break;
+                    }
+
+                    case OpCode::INLINE_ARGS: {
+                        const InlineExpr& inlined = *chunk->inlines[readShort()];
+                        for(size_t i = inlined.arguments.size(); i-- > 0;) {
+                            RuntimeValue value = pop();
+                            TypeTag type = value.typeTag();
+                            interpreter.environment->defineAt(inlined.slot + i,std::move(value),type);
+                        }
+                        interpreter.checkInlineArguments(inlined);
+                        break;
+                    }
+
+                    case OpCode::INLINE_RETURN: {
+                        const InlineExpr& inlined = *chunk->inlines[readShort()];
+                        push(interpreter.inlineResult(inlined,pop()));
+                        break;
+                    }
+
+                    case OpCode::GET_INVARIANT: {
+                        uint16_t depth = readShort();
+                        uint16_t slot = readShort();
+                        uint16_t offset = readShort();
+                        if(interpreter.environment->getTypeAt(depth,slot) == TypeTag::VARIABLE) {
+                            push(interpreter.environment->getAt(depth,slot));
+                            ip += offset;
+                        } else {
+                            invariantWarnings = Warning::issued;
+                        }
+                        break;
+                    }
+
+                    case OpCode::SET_INVARIANT: {
+                        uint16_t depth = readShort();
+                        uint16_t slot = readShort();
+                        if(Warning::issued == invariantWarnings) interpreter.storeInvariant(depth,slot,peek());
+                        break;
+                    }
+
+                    case OpCode::CLEAR_INVARIANTS: {
+                        uint16_t slot = readShort();
+                        interpreter.clearInvariants(slot,readShort());
+                        break;
+                    }
+
+                    case OpCode::COUNTED_TEST: {
+                        uint16_t slot = readShort();
+                        const Token& Operator = readToken();
+                        uint16_t offset = readShort();
+                        RuntimeValue limit = pop();
+                        if(!interpreter.countedTest(Operator,interpreter.environment->getAt(0,slot),limit)) ip += offset;
+                        break;
+                    }
+
+                    case OpCode::COUNTED_STEP: {
+                        uint16_t slot = readShort();
+                        int step = chunk->constants[readShort()].asSmallInt();
+                        uint16_t offset = readShort();
+                        if(interpreter.countedStep(*interpreter.environment,slot,step)) ip += offset;
+                        break;
+                    }
+
+                    case OpCode::FUNCTION: {
+                        const Chunk* function = program->functions[readShort()].get();
+                        FunctionStmt& stmt = *function->declaration;
+                        interpreter.defineVariable(stmt.slot,stmt.name,makeRef<Function>(stmt,interpreter.environment,false,function),TypeTag::FUNCTION);
+                        break;
+                    }
+
+                    case OpCode::CLASS: {
+                        const ClassProto& proto = program->classes[readShort()];
+                        RuntimeValue superclass = _NIL;
+                        if(proto.declaration->superclass != nullptr) superclass = pop();
+                        interpreter.defineClass(*proto.declaration,superclass,proto.methods);
+                        break;
+                    }
+
+                    case OpCode::PUSH_SCOPE: {
+                        uint16_t slots = readShort();
+                        bool escapes = readByte();
+                        interpreter.environment = interpreter.newFrame(interpreter.environment,slots,escapes);
+                        break;
+                    }
+
+                    case OpCode::POP_SCOPE: {
+                        Ref<Environment> scope = interpreter.environment;
+                        interpreter.environment = scope->enclosing;
+                        interpreter.arena.release(scope.get());
+                        break;
+                    }
+
+                    case OpCode::RETURN: {
+                        const Token& keyword = readToken();
+                        RuntimeValue value = pop();
+                        finishCall(frame->function->returnValue(interpreter,keyword,value,frame->receiver));
+                        reload();
+                        break;
+                    }
+
+                    case OpCode::END:
+                        finishCall(frame->function->implicitReturn(frame->receiver));
+                        reload();
+                        break;
+
+                    case OpCode::HALT:
+                        return;
+                }
+            }
+        }
+
+    public:
+        VM(Interpreter& interpreter) : interpreter(interpreter) {}
+
+        void interpret(const Program& program) {
+            this->program = &program;
+            Ref<Environment> environment = interpreter.environment;
+            size_t arenaMark = interpreter.arena.mark();
+            try {
+                frames.push_back(CallFrame{&program.script,0,0,arenaMark,environment,nullptr,_NIL});
+                run();
+            } catch(RuntimeError& err) {
+                std::cerr<<err.message();
+            }
+            interpreter.environment = environment;
+            interpreter.arena.releaseTo(arenaMark);
+            frames.clear();
+            stack.clear();
+        }
+};
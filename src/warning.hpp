@@ -2,10 +2,18 @@
 
 #include "sourceManager.hpp"
 #include "token.hpp"
+#include <cstdint>
 #include <string>
 
 class Warning {
     public:
+        // Warnings constructed so far; every one is printed when made.
+        static inline uint64_t issued = 0;
+
+        Warning() {
+            issued++;
+        }
+
         virtual const std::string what() const {
             return "Warning";
         }
@@ -42,6 +42,11 @@ def getSubClasses():
         identifiers = []
         types = []
 
+        # "type name = value" declares a member filled in after construction
+        # (e.g. by the Resolver); it is left out of the constructor.
+        defaulted = [f for f in fields if '=' in f]
+        fields = [f for f in fields if '=' not in f]
+
         for field in fields:
             parts = field.strip().split()
             type_part = ' '.join(parts[:-1])
@@ -51,6 +56,9 @@ def getSubClasses():
             clean_name = name[2:] if name.startswith('**') else name[1:] if name.startswith('*') else name
             subClasses += f"\t{type_part} {clean_name};\n"
 
+        for field in defaulted:
+            subClasses += f"\t{' '.join(field.split())};\n"
+
         subClasses += f"\n\t{className}("
         subClasses += ', '.join(
             f"{types[j]}&& {identifiers[j][2:]}" if identifiers[j].startswith('**')